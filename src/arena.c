@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include "utils.h"
+#include "arena.h"
+
+#define ARENA_ALIGN (sizeof(double) > sizeof(void*) ? \
+                     sizeof(double) : sizeof(void*))
+#define ARENA_ROUND(x) (((x) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define ARENA_HEADER_SIZE ARENA_ROUND(sizeof(arena_block_t))
+
+static arena_block_t *arena_block_new(size_t size)
+{
+  arena_block_t *b = (arena_block_t *) xmalloc(ARENA_HEADER_SIZE + size);
+  b->next = NULL;
+  b->size = size;
+  return b;
+}
+
+static void arena_use_block(arena_t *arena, arena_block_t *b)
+{
+  arena->first = b;
+  arena->ptr = (char *) b + ARENA_HEADER_SIZE;
+  arena->end = arena->ptr + b->size;
+}
+
+arena_t *arena_new(size_t block_size)
+{
+  arena_t *arena = (arena_t *) xmalloc(sizeof(arena_t));
+  arena->block_size = ARENA_ROUND(block_size);
+  arena->full = NULL;
+  arena->allocated = arena->block_size;
+  arena_use_block(arena, arena_block_new(arena->block_size));
+  return arena;
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+  arena_block_t *b;
+  void *p;
+  size = ARENA_ROUND(size);
+  if ((size_t) (arena->end - arena->ptr) < size)
+  {
+    b = arena_block_new(size > arena->block_size ? size : arena->block_size);
+    arena->allocated += b->size;
+    arena->first->next = arena->full;
+    arena->full = arena->first;
+    arena_use_block(arena, b);
+  }
+  p = arena->ptr;
+  arena->ptr += size;
+  return p;
+}
+
+char *arena_strndup(arena_t *arena, const char *str, size_t len)
+{
+  char *s = (char *) arena_alloc(arena, len + 1);
+  memcpy(s, str, len);
+  s[len] = '\0';
+  return s;
+}
+
+char *arena_strdup(arena_t *arena, const char *str)
+{
+  return arena_strndup(arena, str, strlen(str));
+}
+
+void arena_adopt(arena_t *arena, arena_t *other)
+{
+  arena_block_t *b;
+  b = other->first;
+  b->next = other->full;
+  while (b->next != NULL)
+  {
+    b = b->next;
+  }
+  b->next = arena->full;
+  arena->full = other->first;
+  arena->allocated += other->allocated;
+  free(other);
+}
+
+void arena_reset(arena_t *arena)
+{
+  arena_block_t *b;
+  while (arena->full != NULL)
+  {
+    b = arena->full;
+    arena->full = b->next;
+    free(b);
+  }
+  arena->allocated = arena->first->size;
+  arena_use_block(arena, arena->first);
+}
+
+void arena_free(arena_t *arena)
+{
+  arena_reset(arena);
+  free(arena->first);
+  free(arena);
+}
@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  A simple arena (region) allocator. Memory is obtained from the arena in
+  arbitrary sized chunks and is never freed individually. Instead, the
+  whole arena is reset or freed at once.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct Arena_block{
+  struct Arena_block *next;
+  size_t size; /* the number of bytes available after the header */
+} arena_block_t;
+
+typedef struct{
+  arena_block_t *first; /* the block being filled */
+  arena_block_t *full; /* the blocks already filled */
+  char *ptr; /* the first free byte in the first block */
+  char *end; /* the end of the first block */
+  size_t block_size; /* the default size of a new block */
+  size_t allocated; /* the total size of all blocks */
+} arena_t;
+
+/* Creates an arena that allocates memory in blocks of block_size bytes.
+   Larger requests get blocks of their own. */
+arena_t *arena_new(size_t block_size);
+/* Returns size bytes of memory aligned for any type. Never returns NULL. */
+void *arena_alloc(arena_t *arena, size_t size);
+/* Copies str into the arena. */
+char *arena_strdup(arena_t *arena, const char *str);
+char *arena_strndup(arena_t *arena, const char *str, size_t len);
+/* Makes arena the owner of all memory allocated from other, which is
+   freed. */
+void arena_adopt(arena_t *arena, arena_t *other);
+/* Releases all memory allocated from the arena. Only the most recently
+   allocated block is kept for reuse. */
+void arena_reset(arena_t *arena);
+/* Frees the arena together with all memory allocated from it. */
+void arena_free(arena_t *arena);
+
+#endif
@@ -0,0 +1,824 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <iconv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "utils.h"
+#include "file.h"
+#include "conv.h"
+#include "list.h"
+#include "hashtable.h"
+#include "hashtable_private.h"
+#include "strhash.h"
+#include "options.h"
+#include "paths.h"
+#include "dictionary.h"
+#include "results.h"
+#include "wforms.h"
+#include "cache.h"
+#include "stats.h"
+#include "bench.h"
+
+/* The minimal time (in seconds) a single measurement should take. */
+#define BENCH_MIN_TIME 0.2
+/* The maximal number of keys bench_lookup looks up. */
+#define BENCH_MAX_KEYS (1 << 20)
+/* The number of keys looked up together by bench_lookup, the same as in
+   the keyword search. */
+#define BENCH_BATCH_SIZE 16
+/* The number of keyword and exact queries, word form expansions and
+   sorts measured by bench_json for each file. */
+#define BENCH_QUERIES 1000
+/* The number of regex queries measured by bench_json; each of them scans
+   the whole dictionary. */
+#define BENCH_REGEX_QUERIES 20
+
+typedef struct{
+  const char *s;
+  int len;
+} line_t;
+
+static double get_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Splits data into non-empty lines. Returns the number of lines. */
+static int split_lines(const char *data, size_t length, line_t **plines)
+{
+  size_t i, j;
+  int n, size;
+  line_t *lines;
+
+  size = 1024;
+  lines = (line_t *) xmalloc(size * sizeof(line_t));
+  n = 0;
+  i = 0;
+  while (i < length)
+  {
+    j = i;
+    while (j < length && data[j] != '\n')
+    {
+      ++j;
+    }
+    if (j - i > 0 && j - i <= MAX_ENTRY_LEN && data[i] != '#')
+    {
+      if (n == size)
+      {
+        size *= 2;
+        lines = (line_t *) xrealloc(lines, size * sizeof(line_t));
+      }
+      lines[n].s = data + i;
+      lines[n].len = j - i;
+      ++n;
+    }
+    i = j + 1;
+  }
+  *plines = lines;
+  return n;
+}
+
+static iconv_t cdesc;
+
+typedef int (*conv_func_t)(const char *s, size_t s_len,
+                           char *out, size_t out_size);
+
+static int iconv_conv(const char *s, size_t s_len, char *out,
+                      size_t out_size)
+{
+  char *o = out;
+  size_t o_len = out_size - 1;
+  iconv(cdesc, NULL, NULL, NULL, NULL);
+  if (iconv(cdesc, (char **) &s, &s_len, &o, &o_len) == (size_t) -1)
+  {
+    return -1;
+  }
+  *o = '\0';
+  return o - out;
+}
+
+static void measure(const char *name, conv_func_t conv,
+                    line_t *lines, int n)
+{
+  char out[MAX_STR_LEN + 1];
+  double t, t0;
+  long bytes;
+  int i, rounds;
+
+  rounds = 0;
+  bytes = 0;
+  t0 = get_time();
+  do{
+    for (i = 0; i < n; ++i)
+    {
+      conv(lines[i].s, lines[i].len, out, MAX_STR_LEN + 1);
+      bytes += lines[i].len;
+    }
+    ++rounds;
+    t = get_time() - t0;
+  }while(t < BENCH_MIN_TIME);
+  printf("  %-40s %8.1f ns/line %8.1f MB/s\n", name,
+         t * 1e9 / ((double) n * rounds), bytes / t / 1e6);
+}
+
+void bench_conv(const char *path)
+{
+  file_t *file;
+  line_t *lines;
+  line_t *iso_lines;
+  line_t *utf8_lines;
+  char *iso_data;
+  char *utf8_data;
+  char *p;
+  int n, i, len;
+  size_t size;
+
+  file = file_load(path);
+  if (file == NULL)
+  {
+    return;
+  }
+  n = split_lines(file->data, file->length, &lines);
+
+  /* prepare the same lines in both encodings */
+  size = file->length * 2 + n + 1;
+  iso_data = (char *) xmalloc(size);
+  utf8_data = (char *) xmalloc(size * 2);
+  iso_lines = (line_t *) xmalloc(n * sizeof(line_t));
+  utf8_lines = (line_t *) xmalloc(n * sizeof(line_t));
+  p = file->converted ? iso_data : utf8_data;
+  for (i = 0; i < n; ++i)
+  {
+    if (file->converted)
+    {
+      len = conv_utf8_to_iso_8859_15(lines[i].s, lines[i].len, p,
+                                     MAX_STR_LEN + 1);
+      if (len == -1)
+      { /* the line cannot be represented in ISO-8859-15 */
+        len = 0;
+      }
+      iso_lines[i].s = p;
+      iso_lines[i].len = len;
+      utf8_lines[i] = lines[i];
+    }
+    else
+    {
+      len = conv_iso_8859_15_html_to_utf8(lines[i].s, lines[i].len, p,
+                                          MAX_STR_LEN + 1);
+      utf8_lines[i].s = p;
+      utf8_lines[i].len = len;
+      iso_lines[i] = lines[i];
+    }
+    p += len + 1;
+  }
+
+  printf("conv: %s: %d lines, %lu bytes\n", path, n,
+         (unsigned long) file->length);
+
+  cdesc = iconv_open("UTF-8", "ISO-8859-15");
+  if (cdesc != (iconv_t) -1)
+  {
+    measure("iconv (ISO-8859-15 => UTF-8)", iconv_conv, iso_lines, n);
+    iconv_close(cdesc);
+  }
+  measure("conv_iso_8859_15_to_utf8", conv_iso_8859_15_to_utf8,
+          iso_lines, n);
+  measure("conv_iso_8859_15_html_to_utf8", conv_iso_8859_15_html_to_utf8,
+          iso_lines, n);
+  measure("conv_html_to_utf8", conv_html_to_utf8, utf8_lines, n);
+
+  cdesc = iconv_open("ISO-8859-15", "UTF-8");
+  if (cdesc != (iconv_t) -1)
+  {
+    measure("iconv (UTF-8 => ISO-8859-15)", iconv_conv, utf8_lines, n);
+    iconv_close(cdesc);
+  }
+  measure("conv_utf8_to_iso_8859_15", conv_utf8_to_iso_8859_15,
+          utf8_lines, n);
+
+  free(utf8_lines);
+  free(iso_lines);
+  free(utf8_data);
+  free(iso_data);
+  free(lines);
+  file_unload(file);
+}
+
+static int bench_progress()
+{
+  return 1;
+}
+
+static void bench_notify(const char *event)
+{
+}
+
+/* Splits the lines into words delimited by ASCII punctuation and spaces
+   and shuffles them, so that consecutive lookups don't hit neighbouring
+   buckets. Returns the number of words. */
+static int split_words(line_t *lines, int n, line_t **pwords)
+{
+  line_t *words;
+  line_t tmp;
+  unsigned int r;
+  int i, j, k, m;
+  const char *s;
+
+  words = (line_t *) xmalloc(BENCH_MAX_KEYS * sizeof(line_t));
+  m = 0;
+  for (i = 0; i < n && m < BENCH_MAX_KEYS; ++i)
+  {
+    s = lines[i].s;
+    j = 0;
+    while (j < lines[i].len && m < BENCH_MAX_KEYS)
+    {
+      while (j < lines[i].len && (unsigned char) s[j] < 128 &&
+             !isalnum((unsigned char) s[j]))
+      {
+        ++j;
+      }
+      k = j;
+      while (j < lines[i].len && ((unsigned char) s[j] >= 128 ||
+                                  isalnum((unsigned char) s[j])))
+      {
+        ++j;
+      }
+      if (j > k)
+      {
+        words[m].s = s + k;
+        words[m].len = j - k;
+        ++m;
+      }
+    }
+  }
+  r = 12345;
+  for (i = m - 1; i > 0; --i)
+  {
+    r = r * 1103515245 + 12345;
+    j = (r >> 8) % (i + 1);
+    tmp = words[i];
+    words[i] = words[j];
+    words[j] = tmp;
+  }
+  *pwords = words;
+  return m;
+}
+
+static double measure_lookup(struct hashtable *h, line_t *words, int n,
+                             int batched, int *found)
+{
+  const char *keys[BENCH_BATCH_SIZE];
+  int lens[BENCH_BATCH_SIZE];
+  list_t *lst;
+  double t, t0;
+  int i, j, m, rounds;
+
+  rounds = 0;
+  t0 = get_time();
+  do{
+    *found = 0;
+    for (i = 0; i < n; i += BENCH_BATCH_SIZE)
+    {
+      m = n - i < BENCH_BATCH_SIZE ? n - i : BENCH_BATCH_SIZE;
+      lst = NULL;
+      if (batched)
+      {
+        for (j = 0; j < m; ++j)
+        {
+          keys[j] = words[i + j].s;
+          lens[j] = words[i + j].len;
+        }
+        lst = hashtable_search_batch(h, m, keys, lens, lst);
+      }
+      else
+      {
+        for (j = 0; j < m; ++j)
+        {
+          lst = list_copy1_append(hashtable_search(h, words[i + j].s,
+                                                   words[i + j].len), lst);
+        }
+      }
+      *found += list_length(lst);
+      list_free(lst);
+    }
+    ++rounds;
+    t = get_time() - t0;
+  }while(t < BENCH_MIN_TIME);
+  return t * 1e9 / ((double) n * rounds);
+}
+
+/* Creates the dictionaries of file. Returns their number. */
+static int load_dicts(file_t *file, dict_t **dicts)
+{
+  progress_notifier = bench_progress;
+  progress_max = 100;
+  notifier = bench_notify;
+  return dict_create_all(file, dicts);
+}
+
+/* Frees the dictionaries of file, and file itself. */
+static void free_dicts(file_t *file, dict_t **dicts, int n)
+{
+  int i;
+
+  if (n == 0)
+  {
+    file_unload(file);
+  }
+  for (i = 0; i < n; ++i)
+  { /* the last one unloads the file */
+    dict_free(dicts[i]);
+  }
+}
+
+void bench_lookup(const char *path)
+{
+  file_t *file;
+  dict_t *dicts[MAX_DICTS_IN_FILE];
+  line_t *lines;
+  line_t *words;
+  double single, batch;
+  int n, m, i, found1, found2;
+
+  file = file_load(path);
+  if (file == NULL)
+  {
+    return;
+  }
+  n = split_lines(file->data, file->length, &lines);
+  m = split_words(lines, n, &words);
+  free(lines);
+  printf("lookup: %s: %d keys\n", path, m);
+
+  n = load_dicts(file, dicts);
+  for (i = 0; i < n; ++i)
+  {
+    single = measure_lookup(dicts[i]->hash, words, m, 0, &found1);
+    batch = measure_lookup(dicts[i]->hash, words, m, 1, &found2);
+    assert (found1 == found2);
+    printf("  %s: %d results\n", dicts[i]->name, found1);
+    printf("    %-38s %8.1f ns/key\n", "hashtable_search", single);
+    printf("    %-38s %8.1f ns/key\n", "hashtable_search_batch", batch);
+  }
+
+  free(words);
+  free_dicts(file, dicts, n);
+}
+
+static void measure_hash(int func, line_t *lines, int n)
+{
+  struct hashtable *h;
+  double t, t0;
+  long bytes;
+  int i, rounds;
+
+  h = hashtable_create(1, NULL, func);
+  rounds = 0;
+  bytes = 0;
+  t0 = get_time();
+  do{
+    for (i = 0; i < n; ++i)
+    {
+      hash(h, lines[i].s, lines[i].len);
+      bytes += lines[i].len;
+    }
+    ++rounds;
+    t = get_time() - t0;
+  }while(t < BENCH_MIN_TIME);
+  printf("  %-40s %8.1f ns/line %8.1f MB/s\n", strhash_name(func),
+         t * 1e9 / ((double) n * rounds), bytes / t / 1e6);
+  hashtable_destroy(h);
+}
+
+void bench_hash(const char *path)
+{
+  file_t *file;
+  file_t *file2;
+  dict_t *dicts[MAX_DICTS_IN_FILE];
+  line_t *lines;
+  line_t *words;
+  char cache_dir[MAX_STR_LEN];
+  double t, lookup;
+  int caching, precompute_forms, hash_function;
+  int n, m, i, k, func, found;
+
+  file = file_load(path);
+  if (file == NULL)
+  {
+    return;
+  }
+  n = split_lines(file->data, file->length, &lines);
+  m = split_words(lines, n, &words);
+  printf("hash: %s: %d lines, %d keys\n", path, n, m);
+  for (func = 0; func < HASH_FUNCS_NUM; ++func)
+  {
+    measure_hash(func, lines, n);
+  }
+
+  caching = opt_caching;
+  precompute_forms = opt_precompute_forms;
+  hash_function = opt_hash_function;
+  opt_caching = 0;
+  opt_precompute_forms = 0;
+  /* make sure the hashtables are built and not read from the cache */
+  strcpy(cache_dir, path_cache_dir);
+  strcpy(path_cache_dir, "/nonexistent");
+  for (func = 0; func < HASH_FUNCS_NUM; ++func)
+  {
+    opt_hash_function = func;
+    file2 = file_load(path);
+    if (file2 == NULL)
+    {
+      break;
+    }
+    t = get_time();
+    k = load_dicts(file2, dicts);
+    t = get_time() - t;
+    lookup = 0;
+    for (i = 0; i < k; ++i)
+    {
+      lookup += measure_lookup(dicts[i]->hash, words, m, 1, &found);
+    }
+    printf("  %-40s %8.3f s build %8.1f ns/key lookup\n",
+           strhash_name(func), t, k == 0 ? 0 : lookup / k);
+    free_dicts(file2, dicts, k);
+  }
+  opt_caching = caching;
+  opt_precompute_forms = precompute_forms;
+  opt_hash_function = hash_function;
+  strcpy(path_cache_dir, cache_dir);
+
+  free(words);
+  free(lines);
+  file_unload(file);
+}
+
+/* Builds the dictionaries of the file at path with or without estimating
+   the sizes of their hashtables and prints the times. */
+static void measure_build(const char *path, int estimate)
+{
+  file_t *file;
+  dict_t *dicts[MAX_DICTS_IN_FILE];
+  struct rusage usage;
+  double t;
+  int i, n;
+
+  opt_estimate_index_size = estimate;
+  file = file_load(path);
+  if (file == NULL)
+  {
+    return;
+  }
+  t = get_time();
+  n = load_dicts(file, dicts);
+  t = get_time() - t;
+  printf("  %-40s %8.3f s build\n",
+         estimate ? "estimated sizes" : "sizes from the file header", t);
+  for (i = 0; i < n; ++i)
+  {
+    printf("    %-38s %8u keywords %4u rehashes\n", dicts[i]->name,
+           hashtable_count(dicts[i]->hash),
+           hashtable_expansions(dicts[i]->hash));
+  }
+  t = get_time();
+  free_dicts(file, dicts, n);
+  t = get_time() - t;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("  %-40s %8.3f s free, %ld KiB peak RSS\n", "", t,
+         usage.ru_maxrss);
+}
+
+void bench_build(const char *path)
+{
+  char cache_dir[MAX_STR_LEN];
+  int caching, precompute_forms, estimate;
+
+  printf("build: %s\n", path);
+  caching = opt_caching;
+  precompute_forms = opt_precompute_forms;
+  estimate = opt_estimate_index_size;
+  opt_caching = 0;
+  opt_precompute_forms = 0;
+  /* make sure the hashtables are built and not read from the cache, and
+     that no sizes are taken from it */
+  strcpy(cache_dir, path_cache_dir);
+  strcpy(path_cache_dir, "/nonexistent");
+  measure_build(path, 0);
+  measure_build(path, 1);
+  opt_caching = caching;
+  opt_precompute_forms = precompute_forms;
+  opt_estimate_index_size = estimate;
+  strcpy(path_cache_dir, cache_dir);
+}
+
+static int double_cmp(const void *p1, const void *p2)
+{
+  double d1 = *((const double *) p1);
+  double d2 = *((const double *) p2);
+  return d1 < d2 ? -1 : (d1 > d2 ? 1 : 0);
+}
+
+static void json_string(FILE *out, const char *s)
+{
+  fputc('"', out);
+  for (; *s != '\0'; ++s)
+  {
+    if (*s == '"' || *s == '\\')
+    {
+      fprintf(out, "\\%c", *s);
+    }
+    else if ((unsigned char) *s < 0x20)
+    {
+      fprintf(out, "\\u%04x", (unsigned char) *s);
+    }
+    else
+    {
+      fputc(*s, out);
+    }
+  }
+  fputc('"', out);
+}
+
+/* Writes the n times t (in seconds) as a JSON object with their
+   percentiles in microseconds. Sorts t. */
+static void json_times(FILE *out, const char *name, double *t, int n)
+{
+  double sum;
+  int i;
+
+  fprintf(out, "      \"%s\": {\"count\": %d", name, n);
+  if (n > 0)
+  {
+    qsort(t, n, sizeof(double), double_cmp);
+    sum = 0;
+    for (i = 0; i < n; ++i)
+    {
+      sum += t[i];
+    }
+    /* nearest-rank percentiles */
+    fprintf(out, ", \"mean_us\": %.2f, \"p50_us\": %.2f, \"p90_us\": %.2f, "
+            "\"p99_us\": %.2f, \"max_us\": %.2f", sum / n * 1e6,
+            t[(n - 1) / 2] * 1e6, t[(n * 9 + 9) / 10 - 1] * 1e6,
+            t[(n * 99 + 99) / 100 - 1] * 1e6, t[n - 1] * 1e6);
+  }
+  fprintf(out, "}");
+}
+
+/* Writes the totals of the counters and timers of stats.h. */
+static void json_stats(FILE *out)
+{
+  unsigned long counts[STATS_COUNTERS_NUM];
+  unsigned long long ns[STATS_TIMERS_NUM];
+  int i;
+
+  stats_get(counts, ns);
+  fprintf(out, "      \"counters\": {");
+  for (i = 0; i < STATS_COUNTERS_NUM; ++i)
+  {
+    fprintf(out, "%s\"%s\": %lu", i == 0 ? "" : ", ",
+            stats_counter_name(i), counts[i]);
+  }
+  fprintf(out, "},\n      \"stages_ms\": {");
+  for (i = 0; i < STATS_TIMERS_NUM; ++i)
+  {
+    fprintf(out, "%s\"%s\": %.3f", i == 0 ? "" : ", ",
+            stats_timer_name(i), ns[i] / 1e6);
+  }
+  fprintf(out, "},\n");
+}
+
+/* Copies the i-th of the n words to buf as a zero-terminated string. */
+static const char *word_str(line_t *words, int n, int i, char *buf)
+{
+  int len;
+
+  len = words[i % n].len < MAX_STR_LEN ? words[i % n].len : MAX_STR_LEN;
+  memcpy(buf, words[i % n].s, len);
+  buf[len] = '\0';
+  return buf;
+}
+
+/* Measures q searches of the given type for the words in all the k
+   dictionaries, storing the time of each in t. */
+static void measure_queries(dict_t **dicts, int k, line_t *words, int n,
+                            search_t type, double *t, int q)
+{
+  char buf[MAX_STR_LEN + 1];
+  results_t *res;
+  double t0;
+  int i, d;
+
+  for (i = 0; i < q; ++i)
+  {
+    word_str(words, n, i, buf);
+    res = results_new();
+    t0 = get_time();
+    for (d = 0; d < k; ++d)
+    {
+      dict_search_results(dicts[d], buf, type, res);
+    }
+    t[i] = get_time() - t0;
+    results_free(res);
+  }
+}
+
+/* Measures sorting the results of q keyword searches for the words. Returns
+   the overall number of results sorted. */
+static long measure_sort(dict_t **dicts, int k, line_t *words, int n,
+                         double *t, int q)
+{
+  char buf[MAX_STR_LEN + 1];
+  results_t *res;
+  double t0;
+  long num;
+  int i, d;
+
+  num = 0;
+  for (i = 0; i < q; ++i)
+  {
+    word_str(words, n, i, buf);
+    res = results_new();
+    for (d = 0; d < k; ++d)
+    {
+      dict_search_results(dicts[d], buf, SEARCH_KEYWORD, res);
+    }
+    num += res->num;
+    t0 = get_time();
+    sort_results(res);
+    t[i] = get_time() - t0;
+    results_free(res);
+  }
+  return num;
+}
+
+/* Measures the word form expansion of q words, with the wforms cache
+   cleared before each of them. */
+static void measure_wforms(const char *lang, line_t *words, int n,
+                           double *t, int q)
+{
+  char buf[MAX_STR_LEN + 1];
+  list_t *lst;
+  double t0;
+  int i;
+
+  for (i = 0; i < q; ++i)
+  {
+    lst = strlist_node_new(word_str(words, n, i, buf));
+    lst->next = NULL;
+    wforms_cache_clear();
+    t0 = get_time();
+    lst = wforms_add(lst, lang);
+    t[i] = get_time() - t0;
+    strlist_free(lst);
+  }
+  wforms_cache_clear();
+}
+
+/* Runs all the measurements for the file at path and writes them as a
+   JSON object. The cache files are written to path_cache_dir. */
+static void bench_file_json(const char *path, FILE *out)
+{
+  file_t *file;
+  file_t *file2;
+  dict_t *dicts[MAX_DICTS_IN_FILE];
+  line_t *lines;
+  line_t *words;
+  struct rusage usage;
+  double *t;
+  double build, save, load;
+  long sorted;
+  int n, m, k, cached;
+
+  fprintf(out, "    {\n      \"path\": ");
+  json_string(out, path);
+  file = file_load(path);
+  if (file == NULL)
+  {
+    fprintf(out, ",\n      \"error\": \"cannot load the file\"\n    }");
+    return;
+  }
+  n = split_lines(file->data, file->length, &lines);
+  m = split_words(lines, n, &words);
+  free(lines);
+  fprintf(out, ",\n      \"bytes\": %lu,\n      \"lines\": %d,\n"
+          "      \"words\": %d,\n", (unsigned long) file->length, n, m);
+
+  opt_caching = 0;
+  build = save = load = -1;
+  cached = 0;
+  k = 0;
+  file2 = file_load(path);
+  if (file2 != NULL)
+  {
+    build = get_time();
+    k = load_dicts(file2, dicts);
+    build = get_time() - build;
+    if (k > 0)
+    {
+      /* the cache is used only if it is newer than the file */
+      while (time(NULL) <= file_mtime(path))
+      {
+        sleep(1);
+      }
+      save = get_time();
+      cache_save(dicts, k);
+      save = get_time() - save;
+    }
+    free_dicts(file2, dicts, k);
+  }
+  opt_caching = 1;
+  k = 0;
+  file2 = file_load(path);
+  if (file2 != NULL)
+  {
+    load = get_time();
+    k = load_dicts(file2, dicts);
+    load = get_time() - load;
+    cached = k > 0 && dicts[0]->cached;
+  }
+  fprintf(out, "      \"dicts\": %d,\n      \"cold_build_s\": %.6f,\n"
+          "      \"cache_save_s\": %.6f,\n      \"cache_load_s\": %.6f,\n"
+          "      \"cache_used\": %s,\n", k, build, save, load,
+          cached ? "true" : "false");
+
+  t = (double *) xmalloc(BENCH_QUERIES * sizeof(double));
+  if (k > 0 && m > 0)
+  {
+    stats_reset();
+    measure_queries(dicts, k, words, m, SEARCH_KEYWORD, t, BENCH_QUERIES);
+    json_times(out, "keyword", t, BENCH_QUERIES);
+    fprintf(out, ",\n");
+    measure_queries(dicts, k, words, m, SEARCH_EXACT, t, BENCH_QUERIES);
+    json_times(out, "exact", t, BENCH_QUERIES);
+    fprintf(out, ",\n");
+    measure_queries(dicts, k, words, m, SEARCH_REGEX, t,
+                    BENCH_REGEX_QUERIES);
+    json_times(out, "regex", t, BENCH_REGEX_QUERIES);
+    fprintf(out, ",\n");
+    measure_wforms(dicts[0]->langs[0], words, m, t, BENCH_QUERIES);
+    json_times(out, "wforms", t, BENCH_QUERIES);
+    fprintf(out, ",\n");
+    sorted = measure_sort(dicts, k, words, m, t, BENCH_QUERIES);
+    json_times(out, "sort", t, BENCH_QUERIES);
+    fprintf(out, ",\n      \"sort_results\": %ld,\n", sorted);
+    json_stats(out);
+  }
+  free(t);
+  if (file2 != NULL)
+  {
+    free_dicts(file2, dicts, k);
+  }
+  free(words);
+  file_unload(file);
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(out, "      \"peak_rss_kib\": %ld\n    }", usage.ru_maxrss);
+}
+
+void bench_json(const char **paths, int n, FILE *out)
+{
+  int caching, i;
+
+  caching = opt_caching;
+  fprintf(out, "{\n");
+#ifdef VERSION
+  fprintf(out, "  \"version\": \"%s\",\n", VERSION);
+#endif
+  fprintf(out, "  \"time\": %ld,\n  \"files\": [\n", (long) time(NULL));
+  for (i = 0; i < n; ++i)
+  {
+    bench_file_json(paths[i], out);
+    fprintf(out, i + 1 < n ? ",\n" : "\n");
+  }
+  fprintf(out, "  ]\n}\n");
+  opt_caching = caching;
+}
@@ -0,0 +1,50 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The bench unit contains microbenchmarks of the performance critical
+ * parts of the program. They are run with 'dict2 --bench <name> <file>'.
+ * The benchmarks of whole searches are run by the dict2-bench program
+ * (see bench_main.c, 'make bench'), which reports them in JSON.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Measures the character set conversions (see conv.h) on the lines of a
+   dictionary file and compares them with iconv. */
+void bench_conv(const char *path);
+/* Measures keyword lookups in the hashtables of the dictionaries in a
+   dictionary file, one key at a time and in batches. */
+void bench_lookup(const char *path);
+/* Compares the hash functions (see strhash.h): hashing the lines of a
+   dictionary file, and building and looking up its hashtables. */
+void bench_hash(const char *path);
+/* Compares building the hashtables of the dictionaries in a dictionary
+   file with and without estimating their sizes first (see
+   opt_estimate_index_size), i.e. with and without rehashing. */
+void bench_build(const char *path);
+/* Measures building, caching and loading the dictionaries of each of the
+   n files, searching them (keyword, exact and regex searches), expanding
+   word forms and sorting results, and writes the results to out as a
+   JSON object. The cache files are written to path_cache_dir, which
+   should be an empty directory. */
+void bench_json(const char **paths, int n, FILE *out);
+
+#endif
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * dict2-bench runs the benchmarks of the bench unit which report in JSON
+ * (see bench_json), without the graphical interface. It is built and run
+ * by 'make bench'.
+ *
+ * Usage: dict2-bench [-d data_dir] [-o output] [-n lines] [file...]
+ *
+ * Without files it benchmarks honig.txt from data_dir and a file of the
+ * given number of lines (1000000 by default) generated with the default
+ * parameters of gendict (see gendict.h). The word forms
+ * rules are also read from data_dir. The results go to the standard
+ * output unless an output file is given.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "limits.h"
+#include "utils.h"
+#include "strutils.h"
+#include "conv.h"
+#include "list.h"
+#include "wforms.h"
+#include "options.h"
+#include "cache.h"
+#include "paths.h"
+#include "gendict.h"
+#include "bench.h"
+
+/* The number of lines of the generated dictionary file. */
+#define BENCH_LINES 1000000
+
+static int generate(const char *path, unsigned long lines)
+{
+  gendict_t g;
+  FILE *f;
+  int ok;
+
+  f = fopen(path, "w");
+  if (f == NULL)
+  {
+    perror(path);
+    return 0;
+  }
+  gendict_defaults(&g);
+  g.lines = lines;
+  ok = gendict_write(&g, f);
+  if (fclose(f) != 0 || !ok)
+  {
+    perror(path);
+    return 0;
+  }
+  return 1;
+}
+
+/* Standard file paths */
+
+char path_dict2_glade[MAX_STR_LEN];
+char path_dict2_xpm[MAX_STR_LEN];
+char path_honig_txt[MAX_STR_LEN];
+char path_irregular_verbs_de_txt[MAX_STR_LEN];
+char path_config_file[MAX_STR_LEN];
+char path_readme[MAX_STR_LEN];
+char path_cache_dir[MAX_STR_LEN];
+char path_data_dir[MAX_STR_LEN];
+
+static void usage()
+{
+  fprintf(stderr,
+          "Usage: dict2-bench [-d data_dir] [-o output] [-n lines] "
+          "[file...]\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *paths[MAX_FILES];
+  char tmp_dir[MAX_NAME_LEN];
+  char generated[MAX_STR_LEN];
+  const char *output;
+  const char *s;
+  FILE *out;
+  int lines, n, i;
+
+  strcpy(path_data_dir, INSTALL_PREFIX "/share/dict2/");
+  output = NULL;
+  lines = BENCH_LINES;
+  n = 0;
+  for (i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+    {
+      xstrncpy(path_data_dir, argv[++i], MAX_STR_LEN - 2);
+      path_data_dir[MAX_STR_LEN - 2] = '\0';
+      if (path_data_dir[strlen(path_data_dir) - 1] != '/')
+      {
+        strcat(path_data_dir, "/");
+      }
+    }
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+    {
+      output = argv[++i];
+    }
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+    {
+      lines = atoi(argv[++i]);
+    }
+    else if (argv[i][0] == '-' || n == MAX_FILES)
+    {
+      usage();
+    }
+    else
+    {
+      paths[n++] = argv[i];
+    }
+  }
+  strcpy(path_honig_txt, path_data_dir);
+  strcat(path_honig_txt, "honig.txt");
+  strcpy(path_irregular_verbs_de_txt, path_data_dir);
+  strcat(path_irregular_verbs_de_txt, "irregular_verbs_de.txt");
+
+  /* the cache files and the generated file go to a fresh directory, so
+     that nothing from the user's cache is used */
+  s = getenv("TMPDIR");
+  snprintf(tmp_dir, MAX_NAME_LEN, "%s/dict2-bench.XXXXXX",
+           s != NULL ? s : "/tmp");
+  if (mkdtemp(tmp_dir) == NULL)
+  {
+    perror("Cannot create a temporary directory");
+    return 1;
+  }
+  strcpy(path_cache_dir, tmp_dir);
+  generated[0] = '\0';
+  if (n == 0)
+  {
+    paths[n++] = path_honig_txt;
+    if (lines > 0)
+    {
+      snprintf(generated, MAX_STR_LEN, "%s/synthetic-%d.txt", tmp_dir,
+               lines);
+      if (generate(generated, lines))
+      {
+        paths[n++] = generated;
+      }
+    }
+  }
+
+  utils_init();
+  strutils_init();
+  conv_init();
+  list_init();
+  options_set_defaults();
+  wforms_init();
+
+  out = stdout;
+  if (output != NULL && (out = fopen(output, "w")) == NULL)
+  {
+    perror(output);
+    out = stdout;
+  }
+  bench_json(paths, n, out);
+  if (out != stdout)
+  {
+    fclose(out);
+  }
+
+  while ((s = error_str()) != NULL)
+  {
+    fprintf(stderr, "Error: %s\n", s);
+  }
+
+  /* removes the cache files and the generated file */
+  cache_clear();
+  rmdir(tmp_dir);
+
+  wforms_cleanup();
+  options_cleanup();
+  list_cleanup();
+  conv_cleanup();
+  strutils_cleanup();
+  utils_cleanup();
+
+  return 0;
+}
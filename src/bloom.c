@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include "utils.h"
+#include "bloom.h"
+
+#define BLOOM_BITS_PER_KEY 10
+#define BLOOM_K 7
+#define BLOOM_HEADER_SIZE (2 * sizeof(unsigned))
+
+/* 64-bit FNV-1a. The two halves of the result give the two hash functions
+   from which the remaining ones are derived. */
+static unsigned long long bloom_hash(const char *s, int s_len)
+{
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  const unsigned char *p = (const unsigned char *) s;
+  const unsigned char *end = p + s_len;
+  while (p != end)
+  {
+    h ^= *p++;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+bloom_t *bloom_new(unsigned n)
+{
+  bloom_t *b = (bloom_t *) xmalloc(sizeof(bloom_t));
+  unsigned long size;
+  b->log2_size = 6;
+  while ((1UL << b->log2_size) < (unsigned long) n * BLOOM_BITS_PER_KEY)
+  {
+    ++b->log2_size;
+  }
+  b->k = BLOOM_K;
+  size = 1UL << (b->log2_size - 3);
+  b->bits = (unsigned char *) xmalloc(size);
+  bzero(b->bits, size);
+  b->mapped = 0;
+  return b;
+}
+
+bloom_t *bloom_map(const char *data, unsigned long len)
+{
+  bloom_t *b;
+  unsigned log2_size, k;
+  if (len < BLOOM_HEADER_SIZE)
+  {
+    return NULL;
+  }
+  memcpy(&log2_size, data, sizeof(unsigned));
+  memcpy(&k, data + sizeof(unsigned), sizeof(unsigned));
+  if (log2_size < 6 || log2_size > 40 || k == 0 || k > 32 ||
+      len - BLOOM_HEADER_SIZE < (1UL << (log2_size - 3)))
+  {
+    return NULL;
+  }
+  b = (bloom_t *) xmalloc(sizeof(bloom_t));
+  b->log2_size = log2_size;
+  b->k = k;
+  b->bits = (unsigned char *) data + BLOOM_HEADER_SIZE;
+  b->mapped = 1;
+  return b;
+}
+
+unsigned long bloom_bits_size(const bloom_t *b)
+{
+  return 1UL << (b->log2_size - 3);
+}
+
+void bloom_free(bloom_t *b)
+{
+  if (!b->mapped)
+  {
+    free(b->bits);
+  }
+  free(b);
+}
+
+void bloom_add(bloom_t *b, const char *s, int s_len)
+{
+  unsigned long long h = bloom_hash(s, s_len);
+  unsigned long h1 = (unsigned long) (h & 0xffffffffUL);
+  unsigned long h2 = (unsigned long) (h >> 32) | 1;
+  unsigned long mask = (1UL << b->log2_size) - 1;
+  unsigned long i;
+  unsigned j;
+  for (j = 0; j < b->k; ++j)
+  {
+    i = (h1 + j * h2) & mask;
+    b->bits[i >> 3] |= 1 << (i & 7);
+  }
+}
+
+int bloom_check(const bloom_t *b, const char *s, int s_len)
+{
+  unsigned long long h = bloom_hash(s, s_len);
+  unsigned long h1 = (unsigned long) (h & 0xffffffffUL);
+  unsigned long h2 = (unsigned long) (h >> 32) | 1;
+  unsigned long mask = (1UL << b->log2_size) - 1;
+  unsigned long i;
+  unsigned j;
+  for (j = 0; j < b->k; ++j)
+  {
+    i = (h1 + j * h2) & mask;
+    if (((b->bits[i >> 3] >> (i & 7)) & 1) == 0)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  Bloom filters over strings. A Bloom filter answers whether a string may
+  belong to a set, with no false negatives and a small fraction of false
+  positives.
+*/
+
+#ifndef BLOOM_H
+#define BLOOM_H
+
+typedef struct{
+  unsigned char *bits;
+  unsigned log2_size; /* the number of bits is 1 << log2_size */
+  unsigned k; /* the number of hash functions */
+  int mapped; /* nonzero if bits point into a memory mapped file */
+} bloom_t;
+
+/* Creates an empty filter suitable for about n strings. */
+bloom_t *bloom_new(unsigned n);
+/* Creates a filter from len bytes of data consisting of log2_size, k and
+   bits, in this order. The filter refers to data, which must stay valid
+   as long as the filter is used. Returns NULL if the data is obviously
+   corrupt. */
+bloom_t *bloom_map(const char *data, unsigned long len);
+/* Returns the size of b->bits in bytes. */
+unsigned long bloom_bits_size(const bloom_t *b);
+void bloom_free(bloom_t *b);
+
+void bloom_add(bloom_t *b, const char *s, int s_len);
+/* Returns zero if s certainly does not belong to the set. */
+int bloom_check(const bloom_t *b, const char *s, int s_len);
+
+#endif
@@ -34,11 +34,23 @@
 #include "strutils.h"
 #include "utils.h"
 #include "file.h"
+#include "bloom.h"
+#include "strhash.h"
+#include "options.h"
 #include "cache.h"
 
-static char cache_file_path[MAX_NAME_LEN * 3];
+/* Identifies the cache file format; increase when the format changes. */
+#define CACHE_MAGIC 0x32434406
+/* The sizes of the Header, Dict and Hashtable components. */
+#define HEADER_SIZE (2 * sizeof(int))
+#define DICT_SIZE (2 * sizeof(int) + 6 * sizeof(unsigned long))
+#define HASHTABLE_HEADER_SIZE (6 * sizeof(int) + \
+                               sizeof(unsigned long long) + sizeof(void *))
 
-static void get_cache_file_path(file_t *file, int dict_num)
+/* per thread, as dictionaries may be loaded concurrently */
+static THREAD_LOCAL char cache_file_path[MAX_NAME_LEN * 3];
+
+static void get_cache_file_path(file_t *file)
 {
   int len;
 
@@ -51,23 +63,105 @@ static void get_cache_file_path(file_t *file, int dict_num)
   strcpy(cache_file_path + len, file->path);
   strcpy(cache_file_path + len, basename(cache_file_path + len));
   len = strlen(cache_file_path);
-  sprintf(cache_file_path + len, "%u.cache", dict_num);
+  strcpy(cache_file_path + len, ".cache");
 }
 
-int cache_load(dict_t *dict, int dict_num)
+/* Creates a hashtable from the Hashtable component at offset off in the
+   cache file. Returns NULL if the data is obviously corrupt. */
+static struct hashtable *map_hashtable(file_t *file, unsigned long off,
+                                       const char *file_start)
 {
   char *d;
   struct hashtable *h;
+
+  if (off + HASHTABLE_HEADER_SIZE > file->length)
+  {
+    return NULL;
+  }
+  d = (char *) file->data + off;
+  h = (struct hashtable *) xmalloc(sizeof(struct hashtable));
+  h->extra_off = (unsigned long) file->data;
+  h->tablelength = *((int *) d);
+  h->entrycount = *((int *) (d + sizeof(int)));
+  h->loadlimit = *((int *) (d + 2 * sizeof(int)));
+  h->primeindex = *((int *) (d + 3 * sizeof(int)));
+  h->expansions = 0;
+  h->hash_func = *((int *) (d + 4 * sizeof(int)));
+  h->seed = *((unsigned long long *) (d + 6 * sizeof(int)));
+  h->table = (struct entry **) (((char *) *((struct entry ***) (d + 6 * sizeof(int) + sizeof(unsigned long long)))) + h->extra_off);
+  h->file_start = file_start;
+  h->cache_file = file;
+  h->arena = NULL;
+  h->lst = NULL;
+
+  /* perform some rudimentary data correctness checks */
+  if (h->entrycount > h->loadlimit || h->loadlimit > h->tablelength ||
+      h->hash_func < 0 || h->hash_func >= HASH_FUNCS_NUM)
+  {
+    free(h);
+    return NULL;
+  }
+  ++file->ref;
+  return h;
+}
+
+/* Frees the indexes of the first n dictionaries in dicts mapped by
+   cache_load. */
+static void unmap_dicts(dict_t **dicts, int n)
+{
+  int i;
+
+  for (i = 0; i < n; ++i)
+  {
+    if (dicts[i]->bloom != NULL)
+    {
+      bloom_free(dicts[i]->bloom);
+      dicts[i]->bloom = NULL;
+    }
+    if (dicts[i]->forms != NULL)
+    {
+      hashtable_destroy(dicts[i]->forms);
+      dicts[i]->forms = NULL;
+    }
+    if (dicts[i]->norm != NULL)
+    {
+      hashtable_destroy(dicts[i]->norm);
+      dicts[i]->norm = NULL;
+    }
+    if (dicts[i]->parts != NULL)
+    {
+      hashtable_destroy(dicts[i]->parts);
+      dicts[i]->parts = NULL;
+    }
+    hashtable_destroy(dicts[i]->hash);
+    dicts[i]->hash = NULL;
+  }
+}
+
+int cache_load(dict_t **dicts, int n)
+{
+  char *d;
+  char *dd;
   file_t *file;
+  file_t *dict_file;
   time_t t1, t2;
+  unsigned long hash_off;
+  unsigned long forms_off;
+  unsigned long bloom_off;
+  unsigned long norm_off;
+  unsigned long norm_keys_off;
+  unsigned long parts_off;
+  unsigned long len;
+  int i, forms_options;
 
   assert (progress_max > 0);
   assert (progress_notifier != NULL);
-  assert (dict != NULL);
-  assert (dict->file != NULL);
+  assert (n > 0);
+  assert (dicts[0]->file != NULL);
 
-  get_cache_file_path(dict->file, dict_num);
-  t1 = file_mtime(dict->file->path);
+  dict_file = dicts[0]->file;
+  get_cache_file_path(dict_file);
+  t1 = file_mtime(dict_file->path);
   t2 = file_mtime(cache_file_path);
 
   if (t1 != 0 && t2 != 0 && t1 < t2)
@@ -77,30 +171,78 @@ int cache_load(dict_t *dict, int dict_num)
     {
       return 0;
     }
-    ++file->ref;
     d = (char *) file->data;
-    dict->size = *((int *) d);
-    h = (struct hashtable *) xmalloc(sizeof(struct hashtable));
-    h->extra_off = (unsigned long) d;
-    h->tablelength = *((int *) (d + sizeof(int)));
-    h->entrycount = *((int *) (d + 2 * sizeof(int)));
-    h->loadlimit = *((int *) (d + 3 * sizeof(int)));
-    h->primeindex = *((int *) (d + 4 * sizeof(int)));
-    h->table = (struct entry **) (((char *) *((struct entry ***) (d + 5 * sizeof(int)))) + h->extra_off);
-    h->file_start = dict->file->data;
-    h->cache_file = file;
-    h->lst = NULL;
-    dict->hash = h;
-
-    /* perform some rudimentary data correctness checks */
-    if (h->entrycount > h->loadlimit || h->loadlimit > h->tablelength)
-    {
-      free(h);
-      --file->ref;
+    if (file->length < HEADER_SIZE || *((int *) d) != CACHE_MAGIC ||
+        *((int *) (d + sizeof(int))) != n ||
+        file->length < HEADER_SIZE + n * DICT_SIZE)
+    { /* a cache file in an old format */
       file_unload(file);
       return 0;
     }
-
+    for (i = 0; i < n && opt_precompute_forms; ++i)
+    { /* the forms tables are made anew if the options or the rules have
+         changed, or if there are none */
+      forms_options = *((int *) (d + HEADER_SIZE + i * DICT_SIZE +
+                                 sizeof(int)));
+      if (forms_options != dict_forms_options())
+      {
+        file_unload(file);
+        return 0;
+      }
+    }
+    for (i = 0; i < n; ++i)
+    {
+      dd = d + HEADER_SIZE + i * DICT_SIZE;
+      hash_off = *((unsigned long *) (dd + 2 * sizeof(int)));
+      forms_off = *((unsigned long *) (dd + 2 * sizeof(int) +
+                                       sizeof(unsigned long)));
+      bloom_off = *((unsigned long *) (dd + 2 * sizeof(int) +
+                                       2 * sizeof(unsigned long)));
+      norm_off = *((unsigned long *) (dd + 2 * sizeof(int) +
+                                      3 * sizeof(unsigned long)));
+      norm_keys_off = *((unsigned long *) (dd + 2 * sizeof(int) +
+                                           4 * sizeof(unsigned long)));
+      parts_off = *((unsigned long *) (dd + 2 * sizeof(int) +
+                                       5 * sizeof(unsigned long)));
+      dicts[i]->hash = map_hashtable(file, hash_off, dict_file->data);
+      if (dicts[i]->hash == NULL)
+      {
+        if (i == 0)
+        {
+          file_unload(file);
+        }
+        else
+        { /* the file is unloaded with the last hashtable */
+          unmap_dicts(dicts, i);
+        }
+        return 0;
+      }
+      dicts[i]->size = *((int *) dd);
+      if (bloom_off != 0 && bloom_off < file->length)
+      {
+        dicts[i]->bloom = bloom_map(d + bloom_off, file->length - bloom_off);
+      }
+      if (forms_off != 0)
+      {
+        dicts[i]->forms = map_hashtable(file, forms_off, dict_file->data);
+        dicts[i]->forms_options = *((int *) (dd + sizeof(int)));
+      }
+      /* the keys of norm are stored in the cache file itself */
+      if (opt_normalized_index && norm_off != 0 &&
+          norm_keys_off + sizeof(len) <= file->length)
+      {
+        len = *((unsigned long *) (d + norm_keys_off));
+        if (len <= file->length - norm_keys_off - sizeof(len))
+        {
+          dicts[i]->norm = map_hashtable(file, norm_off, d + norm_keys_off +
+                                         sizeof(len));
+        }
+      }
+      if (opt_decompound && parts_off != 0)
+      {
+        dicts[i]->parts = map_hashtable(file, parts_off, dict_file->data);
+      }
+    }
     return 1;
   }
   else
@@ -109,13 +251,54 @@ int cache_load(dict_t *dict, int dict_num)
   }
 }
 
-void cache_save(dict_t *dict, int dict_num)
+int cache_load_sizes(file_t *file, unsigned *counts, int n)
+{
+  file_t *cache;
+  char *d;
+  unsigned long hash_off;
+  int i;
+
+  get_cache_file_path(file);
+  if (file_mtime(cache_file_path) == 0)
+  {
+    return 0;
+  }
+  cache = file_load(cache_file_path);
+  if (cache == NULL)
+  {
+    return 0;
+  }
+  d = (char *) cache->data;
+  if (cache->length < HEADER_SIZE + n * DICT_SIZE ||
+      *((int *) d) != CACHE_MAGIC || *((int *) (d + sizeof(int))) != n)
+  {
+    file_unload(cache);
+    return 0;
+  }
+  for (i = 0; i < n; ++i)
+  {
+    hash_off = *((unsigned long *) (d + HEADER_SIZE + i * DICT_SIZE +
+                                    2 * sizeof(int)));
+    if (hash_off + HASHTABLE_HEADER_SIZE > cache->length)
+    {
+      file_unload(cache);
+      return 0;
+    }
+    /* entrycount is the second field of Hashtable */
+    counts[i] = *((unsigned *) (d + hash_off + sizeof(int)));
+  }
+  file_unload(cache);
+  return 1;
+}
+
+/* Writes the Hashtable, Table, Entries and Lists components for hash at
+   the current position of f. Leaves the position at the end of the
+   file. Returns zero on failure. */
+static int write_hashtable(FILE *f, struct hashtable *hash)
 {
-  FILE *f;
   int size, i, line_idx;
   int zero = 0;
   void *null_ptr = NULL;
-  struct hashtable *hash;
   struct entry *e;
   void **htab;
   void *htab_off;
@@ -123,225 +306,305 @@ void cache_save(dict_t *dict, int dict_num)
   unsigned long pos;
   unsigned long lists_pos;
   list_t *lst;
-  file_t *file;
-
-  assert (dict != NULL);
-  assert (dict->file != NULL);
-  assert (dict->hash != NULL);
-  assert ( ! hashtable_is_cached(dict->hash));
 
-  file = dict->file;
-  get_cache_file_path(file, dict_num);
-
-  f = fopen(cache_file_path, "wb");
-  if (f != NULL)
+  if (fwrite(&hash->tablelength, sizeof(hash->tablelength), 1, f) != 1)
   {
-    notifier("cache_start");
-    /* write Header */
-    if (fwrite(&dict->size, sizeof(dict->size), 1, f) != 1)
-    {
-      syserr("Error writing cache file (1)");
-      fclose(f);
-      cache_clear();
-      return;
-    }
-    hash = dict->hash;
-    if (fwrite(&hash->tablelength, sizeof(hash->tablelength), 1, f) != 1)
-    {
-      syserr("Error writing cache file (2)");
-      fclose(f);
-      cache_clear();
-      return;
-    }
-    if (fwrite(&hash->entrycount, sizeof(hash->entrycount), 1, f) != 1)
-    {
-      syserr("Error writing cache file (3)");
-      fclose(f);
-      cache_clear();
-      return;
-    }
-    if (fwrite(&hash->loadlimit, sizeof(hash->loadlimit), 1, f) != 1)
-    {
-      syserr("Error writing cache file (4)");
-      fclose(f);
-      cache_clear();
-      return;
-    }
-    if (fwrite(&hash->primeindex, sizeof(hash->primeindex), 1, f) != 1)
-    {
-      syserr("Error writing cache file (5)");
-      fclose(f);
-      cache_clear();
-      return;
-    }
-    size = hash->tablelength;
-    htab = (void **) xmalloc(size * sizeof(void *));
-    htab_off = (void *) (ftell(f) + sizeof(htab_off));
-    if (fwrite(&htab_off, sizeof(htab_off), 1, f) != 1)
-    {
-      syserr("Error writing cache file (6)");
-      fclose(f);
-      cache_clear();
-      return;
-    }
+    syserr("Error writing cache file (2)");
+    return 0;
+  }
+  if (fwrite(&hash->entrycount, sizeof(hash->entrycount), 1, f) != 1)
+  {
+    syserr("Error writing cache file (3)");
+    return 0;
+  }
+  if (fwrite(&hash->loadlimit, sizeof(hash->loadlimit), 1, f) != 1)
+  {
+    syserr("Error writing cache file (4)");
+    return 0;
+  }
+  if (fwrite(&hash->primeindex, sizeof(hash->primeindex), 1, f) != 1)
+  {
+    syserr("Error writing cache file (5)");
+    return 0;
+  }
+  if (fwrite(&hash->hash_func, sizeof(hash->hash_func), 1, f) != 1 ||
+      fwrite(&zero, sizeof(zero), 1, f) != 1 ||
+      fwrite(&hash->seed, sizeof(hash->seed), 1, f) != 1)
+  {
+    syserr("Error writing cache file (21)");
+    return 0;
+  }
+  size = hash->tablelength;
+  htab_off = (void *) (ftell(f) + sizeof(htab_off));
+  if (fwrite(&htab_off, sizeof(htab_off), 1, f) != 1)
+  {
+    syserr("Error writing cache file (6)");
+    return 0;
+  }
 
-    /* make space for Table */
-    if (fseek(f, size * sizeof(struct entry *), SEEK_CUR) == -1)
-    {
-      syserr("Error writing cache file (7)");
-      free(htab);
-      fclose(f);
-      cache_clear();
-      return;
-    }
+  /* make space for Table */
+  if (fseek(f, size * sizeof(struct entry *), SEEK_CUR) == -1)
+  {
+    syserr("Error writing cache file (7)");
+    return 0;
+  }
 
-    /* write Entries */
-    lists_pos = ftell(f) + hash->entrycount * sizeof(struct entry);
-    pos = lists_pos;
-    for (i = 0; i < size; ++i)
+  /* write Entries */
+  htab = (void **) xmalloc(size * sizeof(void *));
+  lists_pos = ftell(f) + hash->entrycount * sizeof(struct entry);
+  pos = lists_pos;
+  for (i = 0; i < size; ++i)
+  {
+    e = hash->table[i];
+    if (e != NULL)
     {
-      e = hash->table[i];
-      if (e != NULL)
+      htab[i] = (void *) ftell(f);
+      while (e != NULL)
       {
-        htab[i] = (void *) ftell(f);
-        while (e != NULL)
+        if (fwrite(&e->s_off, sizeof(e->s_off), 1, f) != 1)
         {
-          if (fwrite(&e->s_off, sizeof(e->s_off), 1, f) != 1)
-          {
-            syserr("Error writing cache file (8)");
-            free(htab);
-            fclose(f);
-            cache_clear();
-            return;
-          }
-          if (fwrite(&e->s_len, sizeof(e->s_len), 1, f) != 1)
-          {
-            syserr("Error writing cache file (9)");
-            free(htab);
-            fclose(f);
-            cache_clear();
-            return;
-          }
-          if (fwrite(&e->h, sizeof(e->h), 1, f) != 1)
-          {
-            syserr("Error writing cache file (10)");
-            free(htab);
-            fclose(f);
-            cache_clear();
-            return;
-          }
-          ptr = (void *) pos;
+          syserr("Error writing cache file (8)");
+          free(htab);
+          return 0;
+        }
+        if (fwrite(&e->s_len, sizeof(e->s_len), 1, f) != 1)
+        {
+          syserr("Error writing cache file (9)");
+          free(htab);
+          return 0;
+        }
+        if (fwrite(&e->h, sizeof(e->h), 1, f) != 1)
+        {
+          syserr("Error writing cache file (10)");
+          free(htab);
+          return 0;
+        }
+        ptr = (void *) pos;
+        if (fwrite(&ptr, sizeof(ptr), 1, f) != 1)
+        {
+          syserr("Error writing cache file (11)");
+          free(htab);
+          return 0;
+        }
+        if (e->next != NULL)
+        {
+          ptr = (void *) (ftell(f) + sizeof(ptr));
           if (fwrite(&ptr, sizeof(ptr), 1, f) != 1)
           {
-            syserr("Error writing cache file (11)");
+            syserr("Error writing cache file (12)");
             free(htab);
-            fclose(f);
-            cache_clear();
-            return;
-          }
-          if (e->next != NULL)
-          {
-            ptr = (void *) (ftell(f) + sizeof(ptr));
-            if (fwrite(&ptr, sizeof(ptr), 1, f) != 1)
-            {
-              syserr("Error writing cache file (12)");
-              free(htab);
-              fclose(f);
-              cache_clear();
-              return;
-            }
+            return 0;
           }
-          else
+        }
+        else
+        {
+          if (fwrite(&null_ptr, sizeof(null_ptr), 1, f) != 1)
           {
-            if (fwrite(&null_ptr, sizeof(null_ptr), 1, f) != 1)
-            {
-              syserr("Error writing cache file (13)");
-              free(htab);
-              fclose(f);
-              cache_clear();
-              return;
-            }
+            syserr("Error writing cache file (13)");
+            free(htab);
+            return 0;
           }
-          lst = (list_t*) e->v;
-          pos += (list_length(lst) + 1) * sizeof(int);
-          e = e->next;
-        } // end while
-      }
-      else // not e != NULL
-      {
-        htab[i] = NULL;
-      }
-    } // end for
+        }
+        lst = (list_t*) e->v;
+        pos += (list_length(lst) + 1) * sizeof(int);
+        e = e->next;
+      } // end while
+    }
+    else // not e != NULL
+    {
+      htab[i] = NULL;
+    }
+  } // end for
 
-    /* write Lists */
-    assert (ftell(f) == lists_pos);
-    for (i = 0; i < size; ++i)
+  /* write Lists */
+  assert (ftell(f) == lists_pos);
+  for (i = 0; i < size; ++i)
+  {
+    e = hash->table[i];
+    if (e != NULL)
     {
-      e = hash->table[i];
-      if (e != NULL)
+      while (e != NULL)
       {
-        while (e != NULL)
+        lst = (list_t*) e->v;
+        assert (lst != NULL);
+        while (lst != NULL)
         {
-          lst = (list_t*) e->v;
-          assert (lst != NULL);
-          while (lst != NULL)
+          line_idx = lst->u.entry_line_idx;
+          if (line_idx == 0)
           {
-            line_idx = lst->u.entry_line_idx;
-            if (line_idx == 0)
-            {
-              line_idx = 1;
-            }
-            if (fwrite(&line_idx, sizeof(line_idx), 1, f) != 1)
-            {
-              syserr("Error writing cache file (14)");
-              free(htab);
-              fclose(f);
-              cache_clear();
-              return;
-            }
-            lst = lst->next;
+            line_idx = 1;
           }
-          if (fwrite(&zero, sizeof(zero), 1, f) != 1)
+          if (fwrite(&line_idx, sizeof(line_idx), 1, f) != 1)
           {
-            syserr("Error writing cache file (15)");
+            syserr("Error writing cache file (14)");
             free(htab);
-            fclose(f);
-            cache_clear();
-            return;
+            return 0;
           }
-          e = e->next;
-        } // end while (e != NULL)
-      }
-    } // end for
-    assert (ftell(f) == pos);
+          lst = lst->next;
+        }
+        if (fwrite(&zero, sizeof(zero), 1, f) != 1)
+        {
+          syserr("Error writing cache file (15)");
+          free(htab);
+          return 0;
+        }
+        e = e->next;
+      } // end while (e != NULL)
+    }
+  } // end for
+  assert (ftell(f) == pos);
 
-    /* write Table */
-    if (fseek(f, (size_t) htab_off, SEEK_SET) == -1)
+  /* write Table */
+  if (fseek(f, (size_t) htab_off, SEEK_SET) == -1)
+  {
+    syserr("Error writing cache file (16)");
+    free(htab);
+    return 0;
+  }
+  for (i = 0; i < size; ++i)
+  {
+    if (fwrite(&htab[i], sizeof(htab[i]), 1, f) != 1)
     {
-      syserr("Error writing cache file (16)");
+      syserr("Error writing cache file (17)");
       free(htab);
+      return 0;
+    }
+  }
+  free(htab);
+
+#ifdef DEBUG
+  fprintf(stderr, "\nhtab_off = 0x%lX\n", (size_t) htab_off);
+  fprintf(stderr, "lists_pos = 0x%lX\n", lists_pos);
+  fprintf(stderr, "size = %d\n", size);
+#endif
+
+  if (fseek(f, 0, SEEK_END) == -1)
+  {
+    syserr("Error writing cache file (18)");
+    return 0;
+  }
+  return 1;
+}
+
+/* Writes the components of dict at the end of f and fills in its Dict
+   component at dict_off. Returns zero on failure. */
+static int write_dict(FILE *f, dict_t *dict, unsigned long dict_off)
+{
+  int forms_options = -1;
+  unsigned long hash_off = 0;
+  unsigned long forms_off = 0;
+  unsigned long bloom_off = 0;
+  unsigned long norm_off = 0;
+  unsigned long norm_keys_off = 0;
+  unsigned long parts_off = 0;
+  unsigned long len;
+
+  assert (dict->hash != NULL);
+  assert ( ! hashtable_is_cached(dict->hash));
+
+  hash_off = ftell(f);
+  if (!write_hashtable(f, dict->hash))
+  {
+    return 0;
+  }
+  if (dict->bloom != NULL)
+  {
+    bloom_off = ftell(f);
+    if (fwrite(&dict->bloom->log2_size, sizeof(unsigned), 1, f) != 1 ||
+        fwrite(&dict->bloom->k, sizeof(unsigned), 1, f) != 1 ||
+        fwrite(dict->bloom->bits, bloom_bits_size(dict->bloom), 1, f) != 1)
+    {
+      syserr("Error writing cache file (20)");
+      return 0;
+    }
+  }
+  if (dict->forms != NULL)
+  {
+    assert ( ! hashtable_is_cached(dict->forms));
+    forms_options = dict->forms_options;
+    forms_off = ftell(f);
+    if (!write_hashtable(f, dict->forms))
+    {
+      return 0;
+    }
+  }
+  if (dict->norm != NULL)
+  {
+    assert ( ! hashtable_is_cached(dict->norm));
+    norm_keys_off = ftell(f);
+    len = dict->norm_keys_len;
+    if (fwrite(&len, sizeof(len), 1, f) != 1 ||
+        fwrite(dict->norm_keys, 1, len, f) != len)
+    {
+      syserr("Error writing cache file (22)");
+      return 0;
+    }
+    norm_off = ftell(f);
+    if (!write_hashtable(f, dict->norm))
+    {
+      return 0;
+    }
+  }
+  if (dict->parts != NULL)
+  {
+    assert ( ! hashtable_is_cached(dict->parts));
+    parts_off = ftell(f);
+    if (!write_hashtable(f, dict->parts))
+    {
+      return 0;
+    }
+  }
+  if (fseek(f, dict_off, SEEK_SET) == -1 ||
+      fwrite(&dict->size, sizeof(dict->size), 1, f) != 1 ||
+      fwrite(&forms_options, sizeof(forms_options), 1, f) != 1 ||
+      fwrite(&hash_off, sizeof(hash_off), 1, f) != 1 ||
+      fwrite(&forms_off, sizeof(forms_off), 1, f) != 1 ||
+      fwrite(&bloom_off, sizeof(bloom_off), 1, f) != 1 ||
+      fwrite(&norm_off, sizeof(norm_off), 1, f) != 1 ||
+      fwrite(&norm_keys_off, sizeof(norm_keys_off), 1, f) != 1 ||
+      fwrite(&parts_off, sizeof(parts_off), 1, f) != 1 ||
+      fseek(f, 0, SEEK_END) == -1)
+  {
+    syserr("Error writing cache file (19)");
+    return 0;
+  }
+  return 1;
+}
+
+void cache_save(dict_t **dicts, int n)
+{
+  FILE *f;
+  int magic = CACHE_MAGIC;
+  int i;
+
+  assert (n > 0);
+  assert (dicts[0]->file != NULL);
+
+  get_cache_file_path(dicts[0]->file);
+
+  f = fopen(cache_file_path, "wb");
+  if (f != NULL)
+  {
+    notifier("cache_start");
+    /* write Header; the Dict components are filled in by write_dict */
+    if (fwrite(&magic, sizeof(magic), 1, f) != 1 ||
+        fwrite(&n, sizeof(n), 1, f) != 1 ||
+        fseek(f, HEADER_SIZE + n * DICT_SIZE, SEEK_SET) == -1)
+    {
+      syserr("Error writing cache file (1)");
       fclose(f);
       cache_clear();
       return;
     }
-    for (i = 0; i < size; ++i)
+    for (i = 0; i < n; ++i)
     {
-      if (fwrite(&htab[i], sizeof(htab[i]), 1, f) != 1)
+      if (!write_dict(f, dicts[i], HEADER_SIZE + i * DICT_SIZE))
       {
-        syserr("Error writing cache file (17)");
-        free(htab);
         fclose(f);
         cache_clear();
         return;
       }
     }
-    free(htab);
-
-#ifdef DEBUG
-    fprintf(stderr, "\nhtab_off = 0x%lX\n", (size_t) htab_off);
-    fprintf(stderr, "lists_pos = 0x%lX\n", lists_pos);
-    fprintf(stderr, "size = %d\n", size);
-#endif
 
     fclose(f);
 
@@ -33,14 +33,19 @@
    so they should be set to sensible values before calling this
    function */
 
-/* Loads a cached dictionary. Returns NULL if the dictionary
-  is not currently cached. */
-int cache_load(dict_t *dict, int dict_num);
-/* Saves a dictionary in a special cache file. The previous content
-  of the cache file (if any) is lost. Sends a notification event "cache_start"
-  (ie. calls notifier("start_start"), see utils.h) upon starting the caching,
-  and "cache_finish" upon ending. */
-void cache_save(dict_t *dict, int dict_num);
+/* Loads the indexes of all the n dictionaries of a file, which are
+  cached together. Returns 0 if they are not currently cached. */
+int cache_load(dict_t **dicts, int n);
+/* Saves all the n dictionaries of a file in a special cache file. The
+  previous content of the cache file (if any) is lost. Sends a
+  notification event "cache_start" (ie. calls notifier("start_start"),
+  see utils.h) upon starting the caching, and "cache_finish" upon
+  ending. */
+void cache_save(dict_t **dicts, int n);
+/* Reads the numbers of keywords of the n dictionaries of file from its
+  cache file, even if the cache is outdated, into counts. Returns 0 if
+  there is no cache file for them. */
+int cache_load_sizes(file_t *file, unsigned *counts, int n);
 /* Removes all files in the cache directory. */
 void cache_clear();
 
@@ -0,0 +1,425 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <ctype.h>
+#include <string.h>
+
+#include "utils.h"
+#include "conv.h"
+
+/* The size of the perfect hash table for HTML character entities. Must be
+   a power of 2. */
+#define ENTITY_TABLE_SIZE 4096
+#define MAX_ENTITY_LEN 8
+
+typedef struct{
+  const char *name;
+  unsigned ucs;
+} entity_t;
+
+/* HTML 4 character entities: the whole ISO-8859-1 set and the special
+   characters, together with the few symbols commonly seen in dictionary
+   files. */
+static const entity_t entities[] = {
+  {"quot", 34}, {"amp", 38}, {"apos", 39}, {"lt", 60}, {"gt", 62},
+  {"nbsp", 160}, {"iexcl", 161}, {"cent", 162}, {"pound", 163},
+  {"curren", 164}, {"yen", 165}, {"brvbar", 166}, {"sect", 167},
+  {"uml", 168}, {"copy", 169}, {"ordf", 170}, {"laquo", 171},
+  {"not", 172}, {"shy", 173}, {"reg", 174}, {"macr", 175}, {"deg", 176},
+  {"plusmn", 177}, {"sup2", 178}, {"sup3", 179}, {"acute", 180},
+  {"micro", 181}, {"para", 182}, {"middot", 183}, {"cedil", 184},
+  {"sup1", 185}, {"ordm", 186}, {"raquo", 187}, {"frac14", 188},
+  {"frac12", 189}, {"frac34", 190}, {"iquest", 191}, {"Agrave", 192},
+  {"Aacute", 193}, {"Acirc", 194}, {"Atilde", 195}, {"Auml", 196},
+  {"Aring", 197}, {"AElig", 198}, {"Ccedil", 199}, {"Egrave", 200},
+  {"Eacute", 201}, {"Ecirc", 202}, {"Euml", 203}, {"Igrave", 204},
+  {"Iacute", 205}, {"Icirc", 206}, {"Iuml", 207}, {"ETH", 208},
+  {"Ntilde", 209}, {"Ograve", 210}, {"Oacute", 211}, {"Ocirc", 212},
+  {"Otilde", 213}, {"Ouml", 214}, {"times", 215}, {"Oslash", 216},
+  {"Ugrave", 217}, {"Uacute", 218}, {"Ucirc", 219}, {"Uuml", 220},
+  {"Yacute", 221}, {"THORN", 222}, {"szlig", 223}, {"agrave", 224},
+  {"aacute", 225}, {"acirc", 226}, {"atilde", 227}, {"auml", 228},
+  {"aring", 229}, {"aelig", 230}, {"ccedil", 231}, {"egrave", 232},
+  {"eacute", 233}, {"ecirc", 234}, {"euml", 235}, {"igrave", 236},
+  {"iacute", 237}, {"icirc", 238}, {"iuml", 239}, {"eth", 240},
+  {"ntilde", 241}, {"ograve", 242}, {"oacute", 243}, {"ocirc", 244},
+  {"otilde", 245}, {"ouml", 246}, {"divide", 247}, {"oslash", 248},
+  {"ugrave", 249}, {"uacute", 250}, {"ucirc", 251}, {"uuml", 252},
+  {"yacute", 253}, {"thorn", 254}, {"yuml", 255},
+  {"OElig", 338}, {"oelig", 339}, {"Scaron", 352}, {"scaron", 353},
+  {"Yuml", 376}, {"fnof", 402}, {"circ", 710}, {"tilde", 732},
+  {"ensp", 8194}, {"emsp", 8195}, {"thinsp", 8201}, {"zwnj", 8204},
+  {"zwj", 8205}, {"lrm", 8206}, {"rlm", 8207}, {"ndash", 8211},
+  {"mdash", 8212}, {"lsquo", 8216}, {"rsquo", 8217}, {"sbquo", 8218},
+  {"ldquo", 8220}, {"rdquo", 8221}, {"bdquo", 8222}, {"dagger", 8224},
+  {"Dagger", 8225}, {"bull", 8226}, {"hellip", 8230}, {"permil", 8240},
+  {"prime", 8242}, {"Prime", 8243}, {"lsaquo", 8249}, {"rsaquo", 8250},
+  {"euro", 8364}, {"trade", 8482}
+};
+
+#define ENTITIES ((int) (sizeof(entities) / sizeof(entities[0])))
+
+/* entity_table[entity_hash(name)] is the index of the entity plus one, or
+   zero if there is no entity with this hash value. entity_seed is chosen
+   by conv_init so that there are no collisions - i.e. the hash function is
+   perfect for the set of entity names. */
+static unsigned char entity_table[ENTITY_TABLE_SIZE];
+static unsigned entity_seed;
+
+/* iso_utf8[c] is the UTF-8 encoding of the ISO-8859-15 character c;
+   iso_utf8[c][0] is the length of the encoding, the remaining bytes are
+   the encoding itself. */
+static unsigned char iso_utf8[256][4];
+
+/* The characters where ISO-8859-15 differs from ISO-8859-1. */
+static const unsigned iso_8859_15_diff[][2] = {
+  {0xa4, 0x20ac}, {0xa6, 0x0160}, {0xa8, 0x0161}, {0xb4, 0x017d},
+  {0xb8, 0x017e}, {0xbc, 0x0152}, {0xbd, 0x0153}, {0xbe, 0x0178}
+};
+
+#define ISO_8859_15_DIFFS 8
+
+static unsigned entity_hash(const char *s, int len, unsigned seed)
+{
+  unsigned h = 2166136261u ^ seed;
+  int i;
+  for (i = 0; i < len; ++i)
+  {
+    h ^= (unsigned char) s[i];
+    h *= 16777619u;
+  }
+  h ^= h >> 15;
+  return h & (ENTITY_TABLE_SIZE - 1);
+}
+
+/* Stores the UTF-8 encoding of the UCS character c in result, which should
+   be at least 4 bytes long. Returns the length of the encoding. Characters
+   above 0x10ffff are replaced with U+FFFD. */
+static int ucs_to_utf8(unsigned c, unsigned char *result)
+{
+  if (c <= 0x7f)
+  {
+    result[0] = c;
+    return 1;
+  }
+  else if (c <= 0x7ff)
+  {
+    result[0] = 0xc0 | (c >> 6);
+    result[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  else if (c <= 0xffff || c > 0x10ffff)
+  {
+    if (c > 0xffff)
+    {
+      c = 0xfffd;
+    }
+    result[0] = 0xe0 | (c >> 12);
+    result[1] = 0x80 | ((c >> 6) & 0x3f);
+    result[2] = 0x80 | (c & 0x3f);
+    return 3;
+  }
+  else
+  {
+    result[0] = 0xf0 | (c >> 18);
+    result[1] = 0x80 | ((c >> 12) & 0x3f);
+    result[2] = 0x80 | ((c >> 6) & 0x3f);
+    result[3] = 0x80 | (c & 0x3f);
+    return 4;
+  }
+}
+
+/* Initialization & cleanup */
+
+void conv_init()
+{
+  int i, ok;
+  unsigned h, c;
+
+  for (c = 0; c < 256; ++c)
+  {
+    iso_utf8[c][0] = ucs_to_utf8(c, iso_utf8[c] + 1);
+  }
+  for (i = 0; i < ISO_8859_15_DIFFS; ++i)
+  {
+    c = iso_8859_15_diff[i][0];
+    iso_utf8[c][0] = ucs_to_utf8(iso_8859_15_diff[i][1], iso_utf8[c] + 1);
+  }
+
+  /* find a seed for which entity_hash has no collisions */
+  entity_seed = 0;
+  do{
+    ok = 1;
+    memset(entity_table, 0, sizeof(entity_table));
+    for (i = 0; i < ENTITIES; ++i)
+    {
+      assert (strlen(entities[i].name) <= MAX_ENTITY_LEN);
+      h = entity_hash(entities[i].name, strlen(entities[i].name),
+                      entity_seed);
+      if (entity_table[h] != 0)
+      {
+        ok = 0;
+        ++entity_seed;
+        break;
+      }
+      entity_table[h] = i + 1;
+    }
+  }while(!ok);
+}
+
+void conv_cleanup()
+{
+}
+
+/* Character set conversions */
+
+int conv_utf8_to_iso_8859_15(const char *s, size_t s_len,
+                             char *out, size_t out_size)
+{
+  const unsigned char *p = (const unsigned char *) s;
+  const unsigned char *end = p + s_len;
+  size_t j = 0;
+  unsigned c;
+  int i, len;
+
+  assert (out_size > 0);
+
+  while (p < end && j < out_size - 1)
+  {
+    c = *p;
+    if (c < 0x80)
+    {
+      out[j++] = c;
+      ++p;
+      continue;
+    }
+    else if ((c & 0xe0) == 0xc0)
+    {
+      c &= 0x1f;
+      len = 2;
+    }
+    else if ((c & 0xf0) == 0xe0)
+    {
+      c &= 0x0f;
+      len = 3;
+    }
+    else
+    { /* a 4-byte sequence cannot be represented anyway */
+      return -1;
+    }
+    if (end - p < len)
+    {
+      return -1;
+    }
+    for (i = 1; i < len; ++i)
+    {
+      if ((p[i] & 0xc0) != 0x80)
+      {
+        return -1;
+      }
+      c = (c << 6) | (p[i] & 0x3f);
+    }
+    p += len;
+    for (i = 0; i < ISO_8859_15_DIFFS; ++i)
+    {
+      if (iso_8859_15_diff[i][0] == c)
+      { /* this ISO-8859-1 character was replaced in ISO-8859-15 */
+        return -1;
+      }
+      if (iso_8859_15_diff[i][1] == c)
+      {
+        c = iso_8859_15_diff[i][0];
+        break;
+      }
+    }
+    if (c > 0xff)
+    {
+      return -1;
+    }
+    out[j++] = c;
+  }
+  out[j] = '\0';
+  return j;
+}
+
+int conv_iso_8859_15_to_utf8(const char *s, size_t s_len,
+                             char *out, size_t out_size)
+{
+  size_t i, j = 0;
+  const unsigned char *u;
+
+  assert (out_size > 0);
+
+  for (i = 0; i < s_len; ++i)
+  {
+    if ((unsigned char) s[i] < 0x80)
+    {
+      if (j + 1 >= out_size)
+      {
+        break;
+      }
+      out[j++] = s[i];
+    }
+    else
+    {
+      u = iso_utf8[(unsigned char) s[i]];
+      if (j + u[0] >= out_size)
+      {
+        break;
+      }
+      memcpy(out + j, u + 1, u[0]);
+      j += u[0];
+    }
+  }
+  out[j] = '\0';
+  return j;
+}
+
+/* Decodes html entities in s. If iso is nonzero, then s is assumed to be in
+   ISO-8859-15, otherwise in UTF-8. */
+static int html_to_utf8(const char *s, size_t s_len, char *out,
+                        size_t out_size, int iso)
+{
+  size_t i, j, k, len;
+  unsigned u, h;
+  unsigned char utf[4];
+  const unsigned char *p;
+
+  assert (out_size > 0);
+
+  i = 0; j = 0;
+  while (i < s_len)
+  {
+    if (s[i] == '&' && i + 1 < s_len)
+    {
+      p = NULL;
+      len = 0;
+      k = i + 1;
+      if (s[k] == '#' && k + 1 < s_len)
+      {
+        ++k;
+        u = 0;
+        if ((s[k] == 'x' || s[k] == 'X') && k + 1 < s_len &&
+            isxdigit((unsigned char) s[k + 1]))
+        {
+          ++k;
+          while (k < s_len && isxdigit((unsigned char) s[k]) &&
+                 u <= 0x10ffff)
+          {
+            u = u * 16 + (isdigit((unsigned char) s[k]) ? s[k] - '0' :
+                          tolower((unsigned char) s[k]) - 'a' + 10);
+            ++k;
+          }
+          p = utf;
+        }
+        else if (isdigit((unsigned char) s[k]))
+        {
+          while (k < s_len && isdigit((unsigned char) s[k]) &&
+                 u <= 0x10ffff)
+          {
+            u = u * 10 + (s[k] - '0');
+            ++k;
+          }
+          p = utf;
+        }
+      }
+      else if (isalpha((unsigned char) s[k]))
+      {
+        while (k < s_len && isalnum((unsigned char) s[k]) &&
+               k - i <= MAX_ENTITY_LEN)
+        {
+          ++k;
+        }
+        h = entity_table[entity_hash(s + i + 1, k - i - 1, entity_seed)];
+        if (h != 0 && strlen(entities[h - 1].name) == k - i - 1 &&
+            memcmp(entities[h - 1].name, s + i + 1, k - i - 1) == 0)
+        {
+          u = entities[h - 1].ucs;
+          p = utf;
+        }
+      }
+      if (p != NULL)
+      { /* a known entity */
+        if (k < s_len && s[k] == ';')
+        {
+          ++k;
+        }
+        if (u == 0 || (u >= 0xd800 && u <= 0xdfff))
+        { /* NUL would cut the entry short and surrogates aren't valid
+             in UTF-8 */
+          u = 0xfffd;
+        }
+        len = ucs_to_utf8(u, utf);
+        if (j + len >= out_size)
+        {
+          break;
+        }
+        memcpy(out + j, utf, len);
+        j += len;
+        i = k;
+        continue;
+      }
+    }
+    /* an ordinary character */
+    if (iso && (unsigned char) s[i] >= 0x80)
+    {
+      p = iso_utf8[(unsigned char) s[i]];
+      if (j + p[0] >= out_size)
+      {
+        break;
+      }
+      memcpy(out + j, p + 1, p[0]);
+      j += p[0];
+    }
+    else
+    {
+      if (j + 1 >= out_size)
+      {
+        break;
+      }
+      out[j++] = s[i];
+    }
+    ++i;
+  } /* end while */
+  if (!iso && i < s_len && (s[i] & 0xc0) == 0x80)
+  { /* don't leave a truncated UTF-8 character at the end */
+    while (j > 0 && (out[j - 1] & 0xc0) == 0x80)
+    {
+      --j;
+    }
+    if (j > 0 && (out[j - 1] & 0xc0) == 0xc0)
+    {
+      --j;
+    }
+  }
+  out[j] = '\0';
+  return j;
+}
+
+int conv_html_to_utf8(const char *s, size_t s_len,
+                      char *out, size_t out_size)
+{
+  return html_to_utf8(s, s_len, out, out_size, 0);
+}
+
+int conv_iso_8859_15_html_to_utf8(const char *s, size_t s_len,
+                                  char *out, size_t out_size)
+{
+  return html_to_utf8(s, s_len, out, out_size, 1);
+}
@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The conv unit implements character set conversions between UTF-8,
+ * ISO-8859-15 and HTML character entities. All conversions are
+ * table-driven and reentrant - the caller provides the output buffer and
+ * no state is shared between calls (the tables are filled once by
+ * conv_init and are read-only afterwards).
+ */
+
+#ifndef CONV_H
+#define CONV_H
+
+#include <sys/types.h>
+
+/* Initialization & cleanup */
+
+void conv_init();
+void conv_cleanup();
+
+/* String conversions */
+
+/* The conversion functions write the converted string into out, which
+   is out_size bytes long (out_size > 0). The result is always
+   null-terminated, and is truncated at a character boundary if out is
+   too small. s does not have to be null-terminated, and may not overlap
+   with out. The functions return the length of the result (not counting
+   the terminating 0), or -1 on failure. */
+
+/* Fails if s is not valid UTF-8 or contains a character not present in
+   ISO-8859-15. */
+int conv_utf8_to_iso_8859_15(const char *s, size_t s_len,
+                             char *out, size_t out_size);
+/* Never fails. */
+int conv_iso_8859_15_to_utf8(const char *s, size_t s_len,
+                             char *out, size_t out_size);
+/* Converts html character entities within a UTF-8 string to corresponding
+   UTF-8 characters. Unknown entities are copied unchanged. Never fails. */
+int conv_html_to_utf8(const char *s, size_t s_len,
+                      char *out, size_t out_size);
+/* The same as conv_iso_8859_15_to_utf8 followed by conv_html_to_utf8, but
+   done in one pass. This is what is needed to read the lines of files
+   downloaded directly from www.dict.cc. */
+int conv_iso_8859_15_html_to_utf8(const char *s, size_t s_len,
+                                  char *out, size_t out_size);
+
+#endif
@@ -32,10 +32,13 @@
 #include "limits.h"
 #include "utils.h"
 #include "strutils.h"
+#include "conv.h"
 #include "list.h"
 #include "rbtree.h"
 #include "wforms.h"
 #include "options.h"
+#include "bench.h"
+#include "stats.h"
 #include "gui.h"
 
 /* Standard file paths */
@@ -57,7 +60,9 @@ int main(int argc, char *argv[])
 #endif
   DIR *dir;
   const char *s;
+  int print_stats;
   char str[MAX_STR_LEN + 1];
+  char stats_text[STATS_TEXT_SIZE];
   str[MAX_STR_LEN] = '\0';
 
 #ifdef DEBUG
@@ -116,6 +121,7 @@ int main(int argc, char *argv[])
 
   utils_init();
   strutils_init();
+  conv_init();
   list_init();
   options_set_defaults();
 
@@ -128,6 +134,15 @@ int main(int argc, char *argv[])
 
   wforms_init();
 
+  print_stats = 0;
+  if (argc > 1 && strcmp(argv[1], "--stats") == 0)
+  { /* print the statistics of the searches at exit */
+    print_stats = 1;
+    argv[1] = argv[0];
+    --argc;
+    ++argv;
+  }
+
   if (argc == 3 && strcmp(argv[1], "--test") == 0)
   {
     if (strcmp(argv[2], "wforms") == 0)
@@ -153,6 +168,29 @@ int main(int argc, char *argv[])
       fprintf(stderr, "Error: Unknown test requested.\n");
     }
   }
+  else if (argc == 4 && strcmp(argv[1], "--bench") == 0)
+  {
+    if (strcmp(argv[2], "conv") == 0)
+    {
+      bench_conv(argv[3]);
+    }
+    else if (strcmp(argv[2], "lookup") == 0)
+    {
+      bench_lookup(argv[3]);
+    }
+    else if (strcmp(argv[2], "hash") == 0)
+    {
+      bench_hash(argv[3]);
+    }
+    else if (strcmp(argv[2], "build") == 0)
+    {
+      bench_build(argv[3]);
+    }
+    else
+    {
+      fprintf(stderr, "Error: Unknown benchmark requested.\n");
+    }
+  }
   else
   {
     if (!run_gui(argc, argv))
@@ -161,6 +199,12 @@ int main(int argc, char *argv[])
     }
   }
 
+  if (print_stats)
+  {
+    stats_format(stats_text, STATS_TEXT_SIZE);
+    fputs(stats_text, stderr);
+  }
+
   options_save_to_file(path_config_file);
 
   while ((s = error_str()) != NULL)
@@ -171,6 +215,7 @@ int main(int argc, char *argv[])
   wforms_cleanup();
   options_cleanup();
   list_cleanup();
+  conv_cleanup();
   strutils_cleanup();
   utils_cleanup();
   return 0;
@@ -23,24 +23,62 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 
 #include "hashtable.h"
+#include "hashtable_itr.h"
 #include "options.h"
 #include "utils.h"
 #include "list.h"
 #include "strutils.h"
+#include "conv.h"
 #include "cache.h"
 #include "wforms.h"
+#include "hll.h"
+#include "stats.h"
 #include "dictionary.h"
 
-/* Used internally by several functions. */
-static dict_t *current_dict;
-static list_t *searched_text_variants_lst = NULL;
+/* Used internally by several functions. This is per thread, so that
+   different dictionaries may be searched at the same time. */
+static THREAD_LOCAL list_t *searched_text_variants_lst = NULL;
+/* Longer keywords are not added to Bloom filters, and longer strings are
+   not checked against them. Any such keyword fits in MAX_STR_LEN bytes
+   when converted to UTF-8. */
+#define MAX_BLOOM_KEY_LEN (MAX_STR_LEN / 2)
+/* The number of strings search_prepend looks up at a time. */
+#define SEARCH_BATCH_SIZE 16
+/* The maximal number of parts a compound word is split into. */
+#define MAX_COMPOUND_PARTS 6
+/* The number of lines sampled to estimate the number of keywords. */
+#define SAMPLE_LINES 8192
+/* How much bigger (in percents) than the estimated number of keywords
+   a new index is made, to allow for the estimation error. */
+#define ESTIMATE_MARGIN 15
+/* Larger estimates are cut down to this. */
+#define MAX_ESTIMATE (1u << 28)
+/* The size of the blocks of dict->arena. */
+#define INDEX_ARENA_BLOCK_SIZE (1 << 20)
 
 static int lst_cmp(const list_t **pnode1, const list_t **pnode2);
-static list_t *node_line_idx_to_entry_list(const list_t *node);
-/* Prepends the results of searching str in dict to lst. */
-static list_t *search_prepend(dict_t *dict, const char *str, list_t *lst);
+static int result_cmp(const result_t *r1, const result_t *r2);
+/* Stores the strings of lst in fields. Returns their number. */
+static int strlist_to_fields(const list_t *lst, char **fields);
+/* Compares two lines of the search results given by the arrays of their
+   entries, for ranking them. */
+static int fields_cmp(char **f1, int n1, char **f2, int n2);
+/* Like strlist_utf8_validate for the entries of a result, but returns
+   the opposite. */
+static int result_not_utf8_validate(const result_t *r);
+/* Converts str to the encoding of dict. Returns str itself or buf, or NULL
+   if str cannot be represented in the encoding. Stores the length of the
+   result in *len. buf should be at least MAX_STR_LEN + 1 bytes long. */
+static const char *dict_encode(dict_t *dict, const char *str, char *buf,
+                               int *len);
+/* Prepends the results of searching each string in strs in h, which is
+   dict->hash or dict->parts, to lst. The lookups are done in batches (see
+   hashtable_search_batch). */
+static list_t *search_prepend(dict_t *dict, struct hashtable *h,
+                              list_t *strs, list_t *lst);
 /* Prepends str to the list of strings - lst */
 static list_t *strlist_prepend(const char *str, list_t *lst);
 static list_t *strlist_convert(const char *str, list_t *lst,
@@ -56,15 +94,110 @@ static list_t *strlist_prepend_umlaut_conversions(list_t *lst);
 static list_t *strlist_prepend_case_conversions(list_t *lst);
 
 static list_t *dict_search_exact(dict_t *dict, const char *what);
-static list_t *dict_search_regex(dict_t *dict, const char *regex);
+/* Adds the lines matching regex to res as soon as they are found, so
+   that progress_notifier may look at the results found so far. */
+static void dict_search_regex(dict_t *dict, const char *regex,
+                              results_t *res);
 
-/* Returns nonzero on success. */
-static int dict_create_hashtable(dict_t *dict, file_t *file,
-                                 int dict_num, int i);
+/* Allocates a dictionary numbered dict_num in file and fills in the
+   fields read from the file header. Returns NULL on failure. */
+static dict_t *dict_new(file_t *file, int dict_num);
+/* Frees the indexes of dict, which may have been built only partially. */
+static void dict_free_indexes(dict_t *dict);
+/* Returns dict->arena, creating it first if needed. */
+static arena_t *dict_arena(dict_t *dict);
+/* Prepends a copy of list1 allocated in dict->arena to list2. */
+static list_t *dict_list_copy_append(dict_t *dict, const list_t *list1,
+                                     list_t *list2);
+/* Inserts the keywords of the line at line_idx, which has just been read
+   into file_entry, into dict->hash. */
+static void dict_hash_line(dict_t *dict, int line_idx);
+/* Adds the keywords of the line just read into file_entry to h. */
+static void dict_sample_line(dict_t *dict, hll_t *h);
+/* Estimates the number of keywords of the n dictionaries of file from a
+   sample of its lines, which start at i, and stores them in counts. */
+static void estimate_keywords(dict_t **dicts, int n, file_t *file, int i,
+                              unsigned *counts);
+/* Stores in sizes the sizes with which the hashtables of the n
+   dictionaries of file should be created. */
+static void dict_index_sizes(dict_t **dicts, int n, file_t *file, int i,
+                             unsigned *sizes);
+/* Creates the hashtables of the n dictionaries of file, reading each
+   line starting at i only once. Returns nonzero on success. */
+static int dict_create_hashtables(dict_t **dicts, int n, file_t *file,
+                                  int i);
+/* Returns the list of strings searched for by a keyword search
+   for keyword. */
+static list_t *keyword_variants(const char *keyword, const char *lang);
+/* Computes dict->forms. */
+static void dict_create_forms_table(dict_t *dict);
+/* Computes dict->bloom. */
+static void dict_create_bloom(dict_t *dict);
+/* Returns a hashtable mapping the keys of src normalized with
+   dict_normalize_key to the lists of lines of all the keys normalized to
+   them. The normalized keys are stored in *keys, their length in
+   *keys_len. */
+static struct hashtable *create_norm_table(dict_t *dict,
+                                           struct hashtable *src,
+                                           char **keys, int *keys_len);
+/* Computes dict->norm and dict->norm_keys. */
+static void dict_create_norm_index(dict_t *dict);
+/* Computes dict->parts. */
+static void dict_create_parts_index(dict_t *dict);
+/* Computes dict->norm_parts and dict->norm_parts_keys. */
+static void dict_create_norm_parts_index(dict_t *dict);
+/* Returns the lines containing all the parts of the compound word s of
+   length len (in the encoding of dict). If there are none, then the first
+   parts are dropped one by one, as the last part of a German compound
+   determines its meaning. */
+static list_t *search_compound_parts(dict_t *dict, const char *s, int len);
+/* Returns the normalized strings searched for in dict->norm by a keyword
+   search for keyword. */
+static list_t *normalized_variants(const char *keyword, const char *lang);
+/* Return handle->variants and handle->norm_variants, computing them first
+   if needed; the WFA thus runs in the threads searching, once per
+   handle. */
+static list_t *handle_variants(keyword_handle_t handle);
+static list_t *handle_norm_variants(keyword_handle_t handle);
 
 /************************************************************************/
 
 static int lst_cmp(const list_t **pnode1, const list_t **pnode2)
+{
+  char *f1[MAX_DICT_ENTRIES];
+  char *f2[MAX_DICT_ENTRIES];
+  int n1, n2;
+
+  assert (pnode1 != NULL);
+  assert (*pnode1 != NULL);
+  assert (pnode2 != NULL);
+  assert (*pnode2 != NULL);
+
+  STATS_INC(STAT_COMPARISONS);
+  n1 = strlist_to_fields((*pnode1)->u.lst, f1);
+  n2 = strlist_to_fields((*pnode2)->u.lst, f2);
+  return fields_cmp(f1, n1, f2, n2);
+}
+
+static int result_cmp(const result_t *r1, const result_t *r2)
+{
+  assert (r1->fields != NULL);
+  assert (r2->fields != NULL);
+  STATS_INC(STAT_COMPARISONS);
+  return fields_cmp(r1->fields, r1->fields_num, r2->fields, r2->fields_num);
+}
+
+static int strlist_to_fields(const list_t *lst, char **fields)
+{
+  int n;
+  for (n = 0; lst != NULL && n < MAX_DICT_ENTRIES; ++n, lst = lst->next)
+  {
+    fields[n] = lst->u.str;
+  }
+  return n;
+}
+
+static int fields_cmp(char **f1, int n1, char **f2, int n2)
 {
   int s1_len, s2_len;
   int ss1_len, ss2_len;
@@ -76,49 +209,35 @@ static int lst_cmp(const list_t **pnode1, const list_t **pnode2)
   char *is2;
   int cmp1, cmp2;
   char c1, c2;
-  list_t *lst1;
-  list_t *lst2;
+  int i;
   list_t *lst;
 
-  assert (pnode1 != NULL);
-  assert (*pnode1 != NULL);
-  assert ((*pnode1)->u.lst != NULL);
-  assert ((*pnode1)->u.lst->u.str != NULL);
-  assert (pnode2 != NULL);
-  assert (*pnode2 != NULL);
-  assert ((*pnode2)->u.lst != NULL);
-  assert ((*pnode2)->u.lst->u.str != NULL);
+  assert (n1 > 0 && f1[0] != NULL);
+  assert (n2 > 0 && f2[0] != NULL);
 
   /* cmp1 = lexicographical comparison (if the key entries are equal, then
     compare by the second entries (fields), etc) */
-  lst1 = (*pnode1)->u.lst;
-  lst2 = (*pnode2)->u.lst;
-  s1 = lst1->u.str;
-  s2 = lst2->u.str;
+  s1 = f1[0];
+  s2 = f2[0];
   cmp1 = g_utf8_collate(s1, s2);
   if (cmp1 == 0)
   {
-    lst1 = lst1->next;
-    lst2 = lst2->next;
-    while (cmp1 == 0 && lst1 != NULL && lst2 != NULL)
+    for (i = 1; cmp1 == 0 && i < n1 && i < n2; ++i)
     {
-      cmp1 = g_utf8_collate(lst1->u.str, lst2->u.str);
-      lst1 = lst1->next;
-      lst2 = lst2->next;
+      cmp1 = g_utf8_collate(f1[i], f2[i]);
     }
     if (cmp1 == 0)
     {
-      if (lst1 == NULL && lst2 == NULL)
+      if (n1 == n2)
       {
         return 0;
       }
-      else if (lst1 == NULL)
+      else if (n1 < n2)
       {
         cmp1 = -1;
       }
       else
       {
-        assert (lst2 == NULL);
         cmp1 = 1;
       }
     }
@@ -250,26 +369,99 @@ static int lst_cmp(const list_t **pnode1, const list_t **pnode2)
   return (cmp2 == 0) ? cmp1 : cmp2;
 }
 
-static list_t *node_line_idx_to_entry_list(const list_t *node)
-{
-  list_t *node2;
-  assert (current_dict != NULL);
-  assert (node != NULL);
-  node2 = list_node_new();
-  node2->u.lst = line_idx_to_entry_list(current_dict, node->u.entry_line_idx);
-  return node2;
-}
 
-static list_t *search_prepend(dict_t *dict, const char *str, list_t *lst)
+static const char *dict_encode(dict_t *dict, const char *str, char *buf,
+                               int *len)
 {
-  list_t *lst2;
   assert (str != NULL);
   if (!dict->converted)
   {
-    str = conv_utf8_to_iso_8859_15(str, strlen(str));
+    *len = conv_utf8_to_iso_8859_15(str, strlen(str), buf, MAX_STR_LEN + 1);
+    if (*len == -1)
+    { /* str cannot be present in an ISO-8859-15 dictionary */
+      return NULL;
+    }
+    return buf;
+  }
+  else
+  {
+    *len = strlen(str);
+    return str;
   }
-  lst2 = (list_t*) hashtable_search(dict->hash, str, strlen(str));
-  return list_copy1_append(lst2, lst);
+}
+
+static list_t *search_prepend(dict_t *dict, struct hashtable *h,
+                              list_t *strs, list_t *lst)
+{
+  const char *keys[SEARCH_BATCH_SIZE];
+  int lens[SEARCH_BATCH_SIZE];
+  char bufs[SEARCH_BATCH_SIZE][MAX_STR_LEN + 1];
+  const char *str;
+  int len;
+  int n;
+  unsigned long long start;
+
+  start = stats_clock();
+  n = 0;
+  for (; strs != NULL; strs = strs->next)
+  {
+    str = strs->u.str;
+    len = strlen(str);
+    if (dict->bloom != NULL && len <= MAX_BLOOM_KEY_LEN &&
+        !bloom_check(dict->bloom, str, len))
+    {
+      STATS_INC(STAT_BLOOM_REJECTED);
+      continue;
+    }
+    str = dict_encode(dict, str, bufs[n], &len);
+    if (str == NULL)
+    {
+      continue;
+    }
+    keys[n] = str;
+    lens[n] = len;
+    if (++n == SEARCH_BATCH_SIZE)
+    {
+      lst = hashtable_search_batch(h, n, keys, lens, lst);
+      n = 0;
+    }
+  }
+  if (n != 0)
+  {
+    lst = hashtable_search_batch(h, n, keys, lens, lst);
+  }
+  STATS_TIME(TIMER_LOOKUP, start);
+  return lst;
+}
+
+/* Like search_prepend, but looks the normalized strings up in h, which is
+   dict->norm or dict->norm_parts. */
+static list_t *search_norm_prepend(struct hashtable *h, list_t *strs,
+                                   list_t *lst)
+{
+  const char *keys[SEARCH_BATCH_SIZE];
+  int lens[SEARCH_BATCH_SIZE];
+  int n;
+  unsigned long long start;
+
+  start = stats_clock();
+  n = 0;
+  for (; strs != NULL; strs = strs->next)
+  {
+    keys[n] = strs->u.str;
+    lens[n] = strlen(strs->u.str);
+    if (++n == SEARCH_BATCH_SIZE)
+    {
+      lst = hashtable_search_batch(h, n, keys, lens, lst);
+      n = 0;
+    }
+  }
+  if (n != 0)
+  {
+    lst = hashtable_search_batch(h, n, keys, lens, lst);
+  }
+  STATS_TIME(TIMER_LOOKUP, start);
+  return lst;
 }
 
 static list_t *strlist_prepend(const char *str, list_t *lst)
@@ -452,6 +644,7 @@ static list_t *dict_search_exact(dict_t *dict, const char *what)
   const char *s;
   int ss_len;
   int i, j;
+  unsigned long long start;
 
   assert (dict != NULL);
   assert (dict->hash != NULL);
@@ -464,14 +657,10 @@ static list_t *dict_search_exact(dict_t *dict, const char *what)
     lst2 = strlist_prepend_umlaut_conversions(lst2);
   }
 
-  lst = NULL;
   list = lst2;
-  while (lst2 != NULL)
-  {
-    lst = search_prepend(dict, lst2->u.str, lst);
-    lst2 = lst2->next;
-  }
+  lst = search_prepend(dict, dict->hash, lst2, NULL);
 
+  start = stats_clock();
   lst2 = NULL;
   while (lst != NULL)
   {
@@ -500,17 +689,18 @@ static list_t *dict_search_exact(dict_t *dict, const char *what)
     }
     lst = lst->next;
   }
+  STATS_TIME(TIMER_READ, start);
   strlist_free(list);
   return lst2;
 }
 
-static list_t *dict_search_regex(dict_t *dict, const char *regex)
+static void dict_search_regex(dict_t *dict, const char *regex,
+                              results_t *res)
 {
   regex_t reg;
   int err, i, step, nexti, prev_i, j, k;
   char error_buf[MAX_STR_LEN + 1];
-  list_t *lst;
-  list_t *node;
+  unsigned long long start;
 
   assert (dict != NULL);
   assert (dict->file != NULL);
@@ -522,20 +712,21 @@ static list_t *dict_search_regex(dict_t *dict, const char *regex)
     error_buf[MAX_STR_LEN] = '\0';
     error(error_buf);
     regfree(&reg);
-    return NULL;
+    return;
   }
+  start = stats_clock();
   i = file_read_header(dict->file);
   step = dict->file->length / progress_max;
   nexti = step;
-  lst = NULL;
   while (i < dict->file->length)
   {
     if (i >= nexti)
     {
       if (progress_notifier() == 0)
       {
+        STATS_TIME(TIMER_REGEX, start);
         regfree(&reg);
-        return lst;
+        return;
       }
       nexti += step;
     }
@@ -544,51 +735,275 @@ static list_t *dict_search_regex(dict_t *dict, const char *regex)
     for (j = 0; j < dict->keys_num; ++j)
     {
       k = dict->entry_order[j];
+      STATS_INC(STAT_REGEX_TESTS);
       if (regexec(&reg, file_entry[k].str, 0, 0, 0) == 0)
       { /* match found */
-        node = list_node_new();
-        node->next = lst;
-        node->u.entry_line_idx = prev_i;
-        lst = node;
+        results_add(res, dict, prev_i);
       }
     }
   } // end main loop
+  STATS_TIME(TIMER_REGEX, start);
   regfree(&reg);
-  return lst;
 }
 
-/* Returns non-zero on success (even if the hashtable was partially read). */
-static int dict_create_hashtable(dict_t *dict, file_t *file,
-                                 int dict_num, int i)
+static void dict_hash_line(dict_t *dict, int line_idx)
 {
   const char *s;
   const char *ss;
   int s_len, ss_len;
   list_t *lst;
   list_t *node;
+  int j, k;
+  const char *file_start = dict->file->data;
+
+  ++dict->size;
+  for (k = 0; k < dict->keys_num; ++k)
+  {
+    j = dict->entry_order[k];
+    s = file_entry[j].s;
+    s_len = file_entry[j].s_len;
+    assert (s_len > 0);
+    /* insert all keywords plus the whole entry */
+    /* skip things in various kinds of brackets */
+    ss = trim_brackets(s, s_len, &ss_len);
+    lst = (list_t*) hashtable_search(dict->hash, ss, ss_len);
+    node = (list_t*) arena_alloc(dict->arena, sizeof(list_t));
+    node->u.entry_line_idx = line_idx;
+    if (lst == 0)
+    {
+      node->next = NULL;
+      hashtable_insert(dict->hash, ss - file_start, ss_len, node);
+    }
+    else
+    {
+      node->next = lst->next;
+      lst->next = node;
+    }
+    j = 0;
+    assert (j < s_len || !isspace(s[0]));
+    while (j < s_len)
+    {
+      ss = s + j;
+      while (j < s_len && !(isspace(s[j]) || ispunct(s[j])))
+      {
+       /* NOTE: We cannot simply use isalnum as we would possibly
+        skip some alphanumeric UTF-8 characters. Alternatively, we
+        could use UTF-8 character manipulation functions, but
+        this would be too complicated and wouldn't work with ISO
+        charater sets. */
+        ++j;
+      }
+      ss_len = s + j - ss;
+      /* Don't hash too short keywords to avoid cluttering the table. */
+      if ((dict->converted &&
+                  g_utf8_strlen(ss, ss_len) >= MIN_KEYWORD_CHARS) ||
+                  (!dict->converted && ss_len >= MIN_KEYWORD_CHARS))
+      {
+        lst = (list_t*) hashtable_search(dict->hash, ss, ss_len);
+        if (lst == 0 || (lst->u.entry_line_idx != line_idx &&
+                   (lst->next == 0 ||
+                   lst->next->u.entry_line_idx != line_idx)))
+        { /* avoid duplicate entries */
+          node = (list_t*) arena_alloc(dict->arena, sizeof(list_t));
+          node->u.entry_line_idx = line_idx;
+          if (lst == 0)
+          {
+            node->next = NULL;
+            hashtable_insert(dict->hash, ss - file_start, ss_len, node);
+          }
+          else
+          {
+            node->next = lst->next;
+            lst->next = node;
+          }
+        }
+      }
+      while (j < s_len && (isspace(s[j]) || ispunct(s[j])))
+      {
+        ++j;
+      }
+    } /* end while (j < s_len) */
+  } /* end for each key */
+}
+
+static void dict_sample_line(dict_t *dict, hll_t *h)
+{
+  const char *s;
+  const char *ss;
+  int s_len, ss_len;
+  int j, k;
+
+  for (k = 0; k < dict->keys_num; ++k)
+  {
+    s = file_entry[dict->entry_order[k]].s;
+    s_len = file_entry[dict->entry_order[k]].s_len;
+    ss = trim_brackets(s, s_len, &ss_len);
+    hll_add(h, ss, ss_len);
+    /* the words are split as in dict_hash_line, but the short ones are
+       told by their length in bytes */
+    j = 0;
+    while (j < s_len)
+    {
+      ss = s + j;
+      while (j < s_len && !(isspace(s[j]) || ispunct(s[j])))
+      {
+        ++j;
+      }
+      if (s + j - ss >= MIN_KEYWORD_CHARS)
+      {
+        hll_add(h, ss, s + j - ss);
+      }
+      while (j < s_len && (isspace(s[j]) || ispunct(s[j])))
+      {
+        ++j;
+      }
+    }
+  }
+}
+
+static void estimate_keywords(dict_t **dicts, int n, file_t *file, int i,
+                              unsigned *counts)
+{
+  /* hlls[2 * d] holds the keywords of dicts[d] in all the sampled lines,
+     hlls[2 * d + 1] in every other one of them */
+  hll_t *hlls;
+  const char *p;
+  double lines, sampled_bytes, all, half, beta;
+  int d, k, start, step, length;
+
+  hlls = (hll_t *) xmalloc(2 * n * sizeof(hll_t));
+  for (d = 0; d < 2 * n; ++d)
+  {
+    hll_clear(&hlls[d]);
+  }
+  /* sample the lines at evenly spaced positions */
+  length = file->length - i;
+  step = length / SAMPLE_LINES;
+  k = 0;
+  sampled_bytes = 0;
+  while (i < file->length)
+  {
+    start = i;
+    i = file_read_line(file, i, 0);
+    if (i == -1)
+    {
+      break;
+    }
+    if (file_entries_read >= dicts[0]->entries_num)
+    {
+      for (d = 0; d < n; ++d)
+      {
+        dict_sample_line(dicts[d], &hlls[2 * d]);
+        if (k % 2 == 0)
+        {
+          dict_sample_line(dicts[d], &hlls[2 * d + 1]);
+        }
+      }
+      ++k;
+      sampled_bytes += i - start;
+    }
+    if (start + step > i)
+    { /* skip to the first line after start + step */
+      if (start + step >= file->length)
+      {
+        break;
+      }
+      p = memchr(file->data + start + step, '\n',
+                 file->length - (start + step));
+      i = (p == NULL) ? file->length : p - file->data + 1;
+    }
+  }
+  /* The number of distinct keywords in m lines grows roughly like
+     m^beta (Heaps' law), where beta is estimated from the two samples. */
+  lines = (k == 0) ? 0 : length / (sampled_bytes / k);
+  for (d = 0; d < n; ++d)
+  {
+    all = hll_count(&hlls[2 * d]);
+    half = hll_count(&hlls[2 * d + 1]);
+    if (lines <= k || half < 1 || all <= half)
+    { /* all the lines have been sampled */
+      counts[d] = (unsigned) all;
+      continue;
+    }
+    beta = log(all / half) / log(2);
+    if (beta > 1)
+    {
+      beta = 1;
+    }
+    all *= pow(lines / k, beta);
+    counts[d] = (all < MAX_ESTIMATE) ? (unsigned) all : MAX_ESTIMATE;
+  }
+  free(hlls);
+}
+
+static void dict_index_sizes(dict_t **dicts, int n, file_t *file, int i,
+                             unsigned *sizes)
+{
+  unsigned counts[MAX_DICTS_IN_FILE];
+  int d;
+
+  if (!opt_estimate_index_size)
+  {
+    for (d = 0; d < n; ++d)
+    {
+      sizes[d] = file_header.size[d];
+    }
+  }
+  else if (cache_load_sizes(file, counts, n))
+  { /* the numbers from an outdated cache should be close */
+    for (d = 0; d < n; ++d)
+    {
+      sizes[d] = hashtable_min_size(counts[d] + counts[d] / 50);
+    }
+  }
+  else
+  {
+    estimate_keywords(dicts, n, file, i, counts);
+    for (d = 0; d < n; ++d)
+    {
+      sizes[d] = hashtable_min_size(counts[d] +
+                                    counts[d] / 100 * ESTIMATE_MARGIN);
+    }
+  }
+}
+
+/* Returns non-zero on success (even if the hashtables were partially
+   read). */
+static int dict_create_hashtables(dict_t **dicts, int n, file_t *file, int i)
+{
   int step, nexti;
-  int j, k, length;
+  int d, length;
   int line_idx;
-  const char *file_start = dict->file->data;
+  unsigned sizes[MAX_DICTS_IN_FILE];
 
-  dict->hash = hashtable_create(file_header.size[dict_num], file_start);
-  if (dict->hash == NULL)
+  dict_index_sizes(dicts, n, file, i, sizes);
+  for (d = 0; d < n; ++d)
   {
-    fatal("Error loading file - cannot create a hashtable.");
-    return 0;
+    dicts[d]->hash = hashtable_create(sizes[d], file->data,
+                                      opt_hash_function);
+    if (dicts[d]->hash == NULL)
+    {
+      fatal("Error loading file - cannot create a hashtable.");
+      return 0;
+    }
+    hashtable_set_arena(dicts[d]->hash, dict_arena(dicts[d]));
+    dicts[d]->size = 0;
   }
   assert (progress_max > 0);
-  dict->size = 0;
   length = file->length;
-  step = length / progress_max;
+  /* progress_notifier is called progress_max times for each dictionary */
+  step = length / (progress_max * n);
   nexti = step;
   while (i < length && i != -1)
   {
     if (i >= nexti)
     {
-      if (progress_notifier() == 0)
+      for (d = 0; d < n; ++d)
       {
-        return 0;
+        if (progress_notifier() == 0)
+        {
+          return 0;
+        }
       }
       nexti += step;
     }
@@ -598,99 +1013,44 @@ static int dict_create_hashtable(dict_t *dict, file_t *file,
     {
       continue;
     }
-    else if (file_entries_read < dict->entries_num || i == -1)
+    else if (file_entries_read < dicts[0]->entries_num || i == -1)
     {
       error("Bad file format. Dictionary partially read.");
-      ++file->ref;
+      for (d = 0; d < n; ++d)
+      {
+        ++file->ref;
+      }
       return 1;
     }
-    ++dict->size;
-    for (k = 0; k < dict->keys_num; ++k)
+    for (d = 0; d < n; ++d)
     {
-      j = dict->entry_order[k];
-      s = file_entry[j].s;
-      s_len = file_entry[j].s_len;
-      assert (s_len > 0);
-      /* insert all keywords plus the whole entry */
-      /* skip things in various kinds of brackets */
-      ss = trim_brackets(s, s_len, &ss_len);
-      lst = (list_t*) hashtable_search(dict->hash, ss, ss_len);
-      node = list_node_new();
-      node->u.entry_line_idx = line_idx;
-      if (lst == 0)
-      {
-        node->next = NULL;
-        hashtable_insert(dict->hash, ss - file_start, ss_len, node);
-      }
-      else
-      {
-        node->next = lst->next;
-        lst->next = node;
-      }
-      j = 0;
-      assert (j < s_len || !isspace(s[0]));
-      while (j < s_len)
-      {
-        ss = s + j;
-        while (j < s_len && !(isspace(s[j]) || ispunct(s[j])))
-        {
-         /* NOTE: We cannot simply use isalnum as we would possibly
-          skip some alphanumeric UTF-8 characters. Alternatively, we
-          could use UTF-8 character manipulation functions, but
-          this would be too complicated and wouldn't work with ISO
-          charater sets. */
-          ++j;
-        }
-        ss_len = s + j - ss;
-        /* Don't hash too short keywords to avoid cluttering the table. */
-        if ((dict->converted &&
-                    g_utf8_strlen(ss, ss_len) >= MIN_KEYWORD_CHARS) ||
-                    (!dict->converted && ss_len >= MIN_KEYWORD_CHARS))
-        {
-          lst = (list_t*) hashtable_search(dict->hash, ss, ss_len);
-          if (lst == 0 || (lst->u.entry_line_idx != line_idx &&
-                     (lst->next == 0 ||
-                     lst->next->u.entry_line_idx != line_idx)))
-          { /* avoid duplicate entries */
-            node = list_node_new();
-            node->u.entry_line_idx = line_idx;
-            if (lst == 0)
-            {
-              node->next = NULL;
-              hashtable_insert(dict->hash, ss - file_start, ss_len, node);
-            }
-            else
-            {
-              node->next = lst->next;
-              lst->next = node;
-            }
-          }
-        }
-        while (j < s_len && (isspace(s[j]) || ispunct(s[j])))
-        {
-          ++j;
-        }
-      } /* end while (j < s_len) */
-    } /* end for each key */
+      dict_hash_line(dicts[d], line_idx);
+    }
   } /* end main loop while (i < length) */
   return 1;
 }
 
-dict_t *dict_create(file_t *file, int dict_num)
+static dict_t *dict_new(file_t *file, int dict_num)
 {
   dict_t *dict;
-  int i, j, k, kk, len0, len1, len2, found, success;
-
-  assert (file != NULL);
-
-  if (file->length == 0)
-  {
-    error("Empty file");
-    return NULL;
-  }
+  int i, j, k, kk, len0, len1, len2, found;
 
   dict = (dict_t*) xmalloc(sizeof(dict_t));
   dict->file = file;
+  dict->forms = NULL;
+  dict->forms_options = 0;
+  dict->bloom = NULL;
+  dict->norm = NULL;
+  dict->norm_keys = NULL;
+  dict->norm_keys_len = 0;
+  dict->parts = NULL;
+  dict->norm_parts = NULL;
+  dict->norm_parts_keys = NULL;
+  dict->hash = NULL;
+  dict->arena = NULL;
+  dict->keywords_num = 0;
+  dict->cached = 0;
+  dict->name[0] = '\0';
   i = file_read_header(file);
   if (i == -1)
   {
@@ -701,6 +1061,8 @@ dict_t *dict_create(file_t *file, int dict_num)
   dict->converted = file_header.converted;
   dict->entries_num = file_header.entries_num;
   dict->keys_num = file_header.keys_num[dict_num];
+  /* until the dictionary is indexed */
+  dict->size = file_header.size[dict_num];
   if (dict->keys_num > dict->entries_num)
   {
     error("Bad file format.");
@@ -764,108 +1126,449 @@ dict_t *dict_create(file_t *file, int dict_num)
     }
   } /* end if converted */
 
-  if (!cache_load(dict, dict_num))
+  return dict;
+}
+
+/* Returns dict->arena, creating it first if needed. */
+static arena_t *dict_arena(dict_t *dict)
+{
+  if (dict->arena == NULL)
   {
-    success = dict_create_hashtable(dict, file, dict_num, i);
-    if (success && opt_caching &&
-        file_size(file->path) >= opt_cache_min_file_size)
-    {
-      cache_save(dict, dict_num);
-    }
+    dict->arena = arena_new(INDEX_ARENA_BLOCK_SIZE);
   }
-  else
+  return dict->arena;
+}
+
+/* Prepends a copy of list1 allocated in dict->arena to list2. */
+static list_t *dict_list_copy_append(dict_t *dict, const list_t *list1,
+                                     list_t *list2)
+{
+  list_t *lst;
+  list_t **plst;
+  arena_t *arena = dict_arena(dict);
+
+  plst = &lst;
+  while (list1 != NULL)
   {
-    success = 1;
+    *plst = (list_t*) arena_alloc(arena, sizeof(list_t));
+    (*plst)->u = list1->u;
+    plst = &(*plst)->next;
+    list1 = list1->next;
   }
+  *plst = list2;
+  return lst;
+}
 
-  if (!dict->converted)
+/* Sets the languages and the name of an unconverted dict.cc dictionary,
+   whose direction can only be told from its keywords. */
+static void dict_guess_langs(dict_t *dict)
+{
+  if (hashtable_search(dict->hash, "schlecht", 8) == NULL)
+  { /* en -> de */
+    strcpy(dict->langs[0], "en");
+    strcpy(dict->langs[1], "de");
+    strcpy(dict->name, "dict.cc (en -> de)");
+  }
+  else
+  { /* de -> en */
+    strcpy(dict->langs[0], "de");
+    strcpy(dict->langs[1], "en");
+    strcpy(dict->name, "dict.cc (de -> en)");
+  }
+}
+
+static void dict_free_indexes(dict_t *dict)
+{
+  if (dict->bloom != NULL)
   {
-    if (hashtable_search(dict->hash, "schlecht", 8) == NULL)
-    { /* en -> de */
-      strcpy(dict->langs[0], "en");
-      strcpy(dict->langs[1], "de");
-      strcpy(dict->name, "dict.cc (en -> de)");
-    }
-    else
-    { /* de -> en */
-      strcpy(dict->langs[0], "de");
-      strcpy(dict->langs[1], "en");
-      strcpy(dict->name, "dict.cc (de -> en)");
-    }
+    bloom_free(dict->bloom);
+    dict->bloom = NULL;
   }
-  dict->keywords_num = hashtable_count(dict->hash);
-  ++file->ref;
-  if (success)
+  if (dict->hash != NULL)
   {
-    return dict;
+    hashtable_destroy(dict->hash);
+    dict->hash = NULL;
   }
-  else
+  if (dict->forms != NULL)
   {
-    dict_free(dict);
-    return NULL;
+    hashtable_destroy(dict->forms);
+    dict->forms = NULL;
+  }
+  if (dict->norm != NULL)
+  {
+    hashtable_destroy(dict->norm);
+    free(dict->norm_keys);
+    dict->norm = NULL;
+    dict->norm_keys = NULL;
+    dict->norm_keys_len = 0;
+  }
+  if (dict->parts != NULL)
+  {
+    hashtable_destroy(dict->parts);
+    dict->parts = NULL;
+  }
+  if (dict->norm_parts != NULL)
+  {
+    hashtable_destroy(dict->norm_parts);
+    free(dict->norm_parts_keys);
+    dict->norm_parts = NULL;
+    dict->norm_parts_keys = NULL;
   }
+  /* all the entries and lists of the tables built in memory */
+  if (dict->arena != NULL)
+  {
+    arena_free(dict->arena);
+    dict->arena = NULL;
+  }
+  dict->keywords_num = 0;
+  dict->cached = 0;
 }
 
-list_t *dict_search(dict_t *dict, const char *what, search_t search_type)
+/* Frees the first n dictionaries of file opened by dict_open_all,
+   without freeing file itself. */
+static void dicts_discard(file_t *file, dict_t **dicts, int n)
 {
-  list_t *lst1;
-  list_t *lst;
-  keyword_handle_t handle;
+  int d;
 
-  switch(search_type){
-    case SEARCH_KEYWORD:
-      handle = dict_keyword_handle_new(what, dict->langs[0]);
-      lst = dict_search_keyword(dict, handle);
-      dict_keyword_handle_free(handle);
-      return lst;
-    case SEARCH_REGEX:
-      create_searched_text_variants_lst(what, dict->langs[0]);
-      lst1 = dict_search_regex(dict, what);
-      break;
-    case SEARCH_EXACT:
-      create_searched_text_variants_lst(what, dict->langs[0]);
-      lst1 = dict_search_exact(dict, what);
-      break;
-    default:
-      fatal("Programming error - unknown search type.");
-      break;
-  };
-  current_dict = dict;
-  lst = list_copy_2(lst1, node_line_idx_to_entry_list);
-  list_free(lst1);
-  return lst;
+  ++file->ref;
+  for (d = 0; d < n; ++d)
+  {
+    dict_free(dicts[d]);
+  }
+  --file->ref;
 }
 
-list_t *dict_search_keyword(dict_t *dict, keyword_handle_t handle)
+int dict_open_all(file_t *file, dict_t **dicts)
 {
-  list_t *lst;
-  list_t *lst2;
+  int n, d;
 
-  lst = handle;
-  lst2 = NULL;
-  while (lst != NULL)
+  assert (file != NULL);
+
+  if (file->length == 0)
   {
-    lst2 = search_prepend(dict, lst->u.str, lst2);
-    lst = lst->next;
+    error("Empty file");
+    return 0;
   }
-
-  current_dict = dict;
-  lst = list_copy_2(lst2, node_line_idx_to_entry_list);
-  list_free(lst2);
-
-  return lst;
-}
+  if (file_read_header(file) == -1)
+  {
+    return 0;
+  }
+  n = file_header.dicts_num;
+  assert (n <= MAX_DICTS_IN_FILE);
+  for (d = 0; d < n; ++d)
+  {
+    dicts[d] = dict_new(file, d);
+    if (dicts[d] == NULL)
+    {
+      while (d > 0)
+      {
+        free(dicts[--d]);
+      }
+      return 0;
+    }
+  }
+  file->ref += n;
+  return n;
+}
+
+int dict_index_all(dict_t **dicts, int n)
+{
+  file_t *file;
+  int i, d, success, cached, whole;
+
+  assert (n > 0);
+  assert (dicts[0]->hash == NULL);
+
+  file = dicts[0]->file;
+  i = file_read_header(file);
+  if (i == -1)
+  {
+    return 0;
+  }
+  /* the cache file holds all the dictionaries of the file */
+  whole = n == file_header.dicts_num;
+  cached = whole && cache_load(dicts, n);
+  if (!cached)
+  {
+    success = dict_create_hashtables(dicts, n, file, i);
+  }
+  else
+  {
+    success = 1;
+  }
+  if (!success)
+  {
+    for (d = 0; d < n; ++d)
+    {
+      dict_free_indexes(dicts[d]);
+    }
+    return 0;
+  }
+
+  for (d = 0; d < n; ++d)
+  {
+    if (!dicts[d]->converted)
+    {
+      dict_guess_langs(dicts[d]);
+    }
+    if (!cached)
+    {
+      dict_create_bloom(dicts[d]);
+    }
+    /* unless mapped from the cache */
+    if (opt_normalized_index && dicts[d]->norm == NULL)
+    {
+      dict_create_norm_index(dicts[d]);
+    }
+    if (opt_decompound && dicts[d]->parts == NULL &&
+        strcmp(dicts[d]->langs[0], "de") == 0)
+    {
+      dict_create_parts_index(dicts[d]);
+    }
+    /* never cached, as it is cheap to compute from parts */
+    if (opt_normalized_index && dicts[d]->norm != NULL &&
+        dicts[d]->parts != NULL && dicts[d]->norm_parts == NULL)
+    {
+      dict_create_norm_parts_index(dicts[d]);
+    }
+  }
+  if (!cached && whole && opt_caching &&
+      file_size(file->path) >= opt_cache_min_file_size)
+  {
+    /* the forms tables need dict->langs, so the dictionaries are saved
+       only now */
+    if (opt_precompute_forms)
+    {
+      for (d = 0; d < n; ++d)
+      {
+        dict_create_forms_table(dicts[d]);
+      }
+    }
+    cache_save(dicts, n);
+  }
+  for (d = 0; d < n; ++d)
+  {
+    dicts[d]->keywords_num = hashtable_count(dicts[d]->hash);
+    dicts[d]->cached = cached;
+  }
+  stats_flush();
+  return 1;
+}
+
+void dict_unindex_all(dict_t **dicts, int n)
+{
+  int d;
+
+  for (d = 0; d < n; ++d)
+  {
+    dict_free_indexes(dicts[d]);
+  }
+}
+
+int dict_create_all(file_t *file, dict_t **dicts)
+{
+  int n;
+
+  n = dict_open_all(file, dicts);
+  if (n == 0)
+  {
+    return 0;
+  }
+  if (!dict_index_all(dicts, n))
+  {
+    dicts_discard(file, dicts, n);
+    return 0;
+  }
+  return n;
+}
+
+list_t *dict_search(dict_t *dict, const char *what, search_t search_type)
+{
+  results_t *res;
+  list_t *lst;
+
+  res = results_new();
+  dict_search_results(dict, what, search_type, res);
+  lst = results_to_list(res);
+  results_free(res);
+  return lst;
+}
+
+void dict_search_results(dict_t *dict, const char *what,
+                         search_t search_type, results_t *res)
+{
+  list_t *lst;
+  keyword_handle_t handle;
+
+  switch(search_type){
+    case SEARCH_KEYWORD:
+      handle = dict_keyword_handle_new(what, dict->langs[0]);
+      dict_search_keyword_results(dict, handle, res);
+      dict_keyword_handle_free(handle);
+      break;
+    case SEARCH_REGEX:
+      STATS_INC(STAT_SEARCHES);
+      create_searched_text_variants_lst(what, dict->langs[0]);
+      dict_search_regex(dict, what, res);
+      break;
+    case SEARCH_EXACT:
+      STATS_INC(STAT_SEARCHES);
+      create_searched_text_variants_lst(what, dict->langs[0]);
+      lst = dict_search_exact(dict, what);
+      results_add_lines(res, dict, lst);
+      list_free(lst);
+      break;
+    default:
+      fatal("Programming error - unknown search type.");
+      return;
+  };
+  stats_flush();
+}
+
+list_t *dict_search_keyword(dict_t *dict, keyword_handle_t handle)
+{
+  results_t *res;
+  list_t *lst;
+
+  res = results_new();
+  dict_search_keyword_results(dict, handle, res);
+  lst = results_to_list(res);
+  results_free(res);
+  return lst;
+}
+
+void dict_search_keyword_results(dict_t *dict, keyword_handle_t handle,
+                                 results_t *res)
+{
+  list_t *lst;
+  list_t *lst2;
+  const char *s;
+  const int *lines;
+  char iso_str[MAX_STR_LEN + 1];
+  int len, num, norm;
+  unsigned long long start;
+
+  STATS_INC(STAT_SEARCHES);
+  num = res->num;
+  norm = dict->norm != NULL && opt_ignore_case &&
+    opt_german_umlaut_conversion;
+  lst = NULL;
+  lst2 = NULL;
+  lines = NULL;
+  if (dict->forms != NULL && dict->forms_options == dict_forms_options() &&
+      strcmp(dict->langs[0], handle->lang) == 0 &&
+      (s = dict_encode(dict, handle->keyword, iso_str, &len)) != NULL)
+  {
+    start = stats_clock();
+    STATS_INC(STAT_PROBES);
+    if (hashtable_is_cached(dict->forms))
+    {
+      lines = hashtable_search_lines(dict->forms, s, len);
+    }
+    else
+    {
+      lst = hashtable_search(dict->forms, s, len);
+    }
+    STATS_TIME(TIMER_LOOKUP, start);
+  }
+  if (lines != NULL)
+  { /* straight from the cache file, without copying */
+    STATS_INC(STAT_HITS);
+    for (; *lines != 0; ++lines)
+    {
+      STATS_INC(STAT_POSTINGS);
+      results_add(res, dict, *lines);
+    }
+  }
+  else if (lst != NULL)
+  {
+    STATS_INC(STAT_HITS);
+    STATS_ADD(STAT_POSTINGS, list_length(lst));
+    results_add_lines(res, dict, lst);
+  }
+  else if (norm)
+  {
+    lst2 = search_norm_prepend(dict->norm, handle_norm_variants(handle),
+                               NULL);
+  }
+  else
+  {
+    lst2 = search_prepend(dict, dict->hash, handle_variants(handle), NULL);
+  }
+  /* the forms table includes the lines found through dict->parts */
+  if (dict->parts != NULL && lines == NULL && lst == NULL)
+  {
+    if (norm && dict->norm_parts != NULL)
+    { /* the same normalized forms, without running the WFA again */
+      lst2 = search_norm_prepend(dict->norm_parts,
+                                 handle_norm_variants(handle), lst2);
+    }
+    else
+    {
+      lst2 = search_prepend(dict, dict->parts, handle_variants(handle),
+                            lst2);
+    }
+    if (lst2 == NULL && res->num == num &&
+        strchr(handle->keyword, ' ') == NULL &&
+        (s = dict_encode(dict, handle->keyword, iso_str, &len)) != NULL)
+    { /* try the parts of the keyword if it's an unknown compound */
+      lst2 = search_compound_parts(dict, s, len);
+    }
+  }
+  results_add_lines(res, dict, lst2);
+  list_free(lst2);
+}
 
 keyword_handle_t dict_keyword_handle_new(const char *keyword,
                                          const char *lang)
+{
+  keyword_handle_t handle;
+
+  create_searched_text_variants_lst(keyword, lang);
+
+  handle = (keyword_handle_t) xmalloc(sizeof(struct Keyword_handle));
+  handle->keyword = xstrdup(keyword);
+  handle->lang = xstrdup(lang);
+  handle->variants = NULL;
+  handle->norm_variants = NULL;
+  pthread_mutex_init(&handle->mutex, NULL);
+  return handle;
+}
+
+static list_t *handle_variants(keyword_handle_t handle)
+{
+  pthread_mutex_lock(&handle->mutex);
+  if (handle->variants == NULL)
+  {
+    handle->variants = keyword_variants(handle->keyword, handle->lang);
+  }
+  pthread_mutex_unlock(&handle->mutex);
+  return handle->variants;
+}
+
+static list_t *handle_norm_variants(keyword_handle_t handle)
+{
+  pthread_mutex_lock(&handle->mutex);
+  if (handle->norm_variants == NULL)
+  {
+    handle->norm_variants = normalized_variants(handle->keyword,
+                                                handle->lang);
+  }
+  pthread_mutex_unlock(&handle->mutex);
+  return handle->norm_variants;
+}
+
+void set_search_results_ranking(const char *what, const char *lang)
+{
+  create_searched_text_variants_lst(what, lang);
+}
+
+static list_t *keyword_variants(const char *keyword, const char *lang)
 {
   list_t *lst2;
   list_t *lst;
-  char str[MAX_STR_LEN + 1];
   int i, single_word;
-  str[MAX_STR_LEN] = '\0';
-
-  create_searched_text_variants_lst(keyword, lang);
+  unsigned long long start;
 
   lst = strlist_prepend(keyword, NULL);
   if (strcmp(lang, "de") == 0)
@@ -895,30 +1598,583 @@ keyword_handle_t dict_keyword_handle_new(const char *keyword,
   }
   if (single_word)
   {
+    start = stats_clock();
     lst = wforms_add(lst, lang);
+    STATS_TIME(TIMER_WFORMS, start);
   }
   lst = strlist_prepend_case_conversions(lst);
+  STATS_ADD(STAT_VARIANTS, list_length(lst));
+  return lst;
+}
+
+void dict_keyword_handle_free(keyword_handle_t handle)
+{
+  if (handle != NULL)
+  {
+    free(handle->keyword);
+    free(handle->lang);
+    strlist_free(handle->variants);
+    strlist_free(handle->norm_variants);
+    pthread_mutex_destroy(&handle->mutex);
+    free(handle);
+  }
+}
+
+int dict_forms_options()
+{
+  return (opt_ignore_case ? 1 : 0) | (opt_german_umlaut_conversion ? 2 : 0) |
+      (opt_search_inflections ? 4 : 0) | (opt_search_stem ? 8 : 0) |
+      (opt_search_forms ? 16 : 0) | (opt_decompound ? 32 : 0) |
+      (int) ((wforms_rules_hash() & 0x1ffffff) << FORMS_OPTIONS_BITS);
+}
+
+static void dict_create_bloom(dict_t *dict)
+{
+  struct hashtable_itr *itr;
+  char str[MAX_STR_LEN + 1];
+  const char *s;
+  int s_len, i, n, len;
 
-#ifdef DEBUG
-  fprintf(stderr, "dict_keyword_handle_new: kwds = %d\n", list_length(lst));
-#endif
+  n = hashtable_count(dict->hash);
+  dict->bloom = bloom_new(n);
+  itr = hashtable_iterator(dict->hash);
+  for (i = 0; i < n; ++i, hashtable_iterator_advance(itr))
+  {
+    s = hashtable_iterator_key_s(itr);
+    s_len = hashtable_iterator_key_s_len(itr);
+    if (dict->converted)
+    {
+      bloom_add(dict->bloom, s, s_len);
+    }
+    else if (s_len <= MAX_BLOOM_KEY_LEN)
+    {
+      len = conv_iso_8859_15_to_utf8(s, s_len, str, MAX_STR_LEN + 1);
+      bloom_add(dict->bloom, str, len);
+    }
+  }
+  free(itr);
+}
+
+static int line_idx_cmp(const list_t **pnode1, const list_t **pnode2)
+{
+  return (*pnode1)->u.entry_line_idx - (*pnode2)->u.entry_line_idx;
+}
+
+static void dict_create_forms_table(dict_t *dict)
+{
+  struct hashtable_itr *itr;
+  list_t *variants;
+  list_t *lst;
+  char str[MAX_STR_LEN + 1];
+  const char *s;
+  int s_len, i, n, step, nexti;
+
+  assert (dict->forms == NULL);
+  notifier("forms_start");
+  n = hashtable_count(dict->hash);
+  /* there are at most n keys, so the table never grows */
+  dict->forms = hashtable_create(hashtable_min_size(n), dict->file->data,
+                                 opt_hash_function);
+  if (dict->forms == NULL)
+  {
+    error("Cannot create the word forms table.");
+    return;
+  }
+  hashtable_set_arena(dict->forms, dict_arena(dict));
+  dict->forms_options = dict_forms_options();
+  step = n / progress_max;
+  nexti = step;
+  itr = hashtable_iterator(dict->hash);
+  for (i = 0; i < n; ++i, hashtable_iterator_advance(itr))
+  {
+    if (i >= nexti)
+    {
+      if (progress_notifier() == 0)
+      {
+        hashtable_destroy(dict->forms);
+        dict->forms = NULL;
+        break;
+      }
+      nexti += step;
+    }
+    s = hashtable_iterator_key_s(itr);
+    s_len = hashtable_iterator_key_s_len(itr);
+    if (memchr(s, ' ', s_len) != NULL || s_len > MAX_STR_LEN / 2)
+    { /* no word forms are searched for multiple words */
+      continue;
+    }
+    if (dict->converted)
+    {
+      memcpy(str, s, s_len);
+      str[s_len] = '\0';
+    }
+    else if (conv_iso_8859_15_to_utf8(s, s_len, str, MAX_STR_LEN + 1) == -1)
+    {
+      continue;
+    }
+    variants = keyword_variants(str, dict->langs[0]);
+    lst = search_prepend(dict, dict->hash, variants, NULL);
+    if (dict->parts != NULL)
+    {
+      lst = search_prepend(dict, dict->parts, variants, lst);
+    }
+    strlist_free(variants);
+    if (lst != NULL)
+    {
+      lst = list_sort(lst, line_idx_cmp);
+      lst = list_unique(lst, line_idx_cmp);
+      hashtable_insert(dict->forms, s - dict->file->data, s_len,
+                       dict_list_copy_append(dict, lst, NULL));
+      list_free(lst);
+    }
+  }
+  free(itr);
+  notifier("forms_finish");
+}
+
+int dict_normalize_key(const char *s, int len, char *buf)
+{
+  gchar *folded;
+  const unsigned char *p;
+  int n;
+
+  folded = g_utf8_casefold(s, len);
+  p = (const unsigned char *) folded;
+  n = 0;
+  while (*p != '\0' && n < MAX_STR_LEN - 1)
+  {
+    if (p[0] == 0xc3 && (p[1] == 0xa4 || p[1] == 0xb6 || p[1] == 0xbc))
+    { /* ä, ö, ü */
+      buf[n++] = p[1] == 0xa4 ? 'a' : (p[1] == 0xb6 ? 'o' : 'u');
+      buf[n++] = 'e';
+      p += 2;
+    }
+    else
+    {
+      buf[n++] = *p++;
+    }
+  }
+  buf[n] = '\0';
+  n = *p == '\0' ? n : -1;
+  g_free(folded);
+  return n;
+}
+
+static int str_cmp(const list_t **pnode1, const list_t **pnode2)
+{
+  return strcmp((*pnode1)->u.str, (*pnode2)->u.str);
+}
+
+static list_t *normalized_variants(const char *keyword, const char *lang)
+{
+  list_t *lst;
+  list_t *lst2;
+  gchar *lower;
+  char str[MAX_STR_LEN + 1];
+  unsigned long long start;
 
+  /* the case doesn't matter in dict->norm, and wforms expects words in
+     lower case (see keyword_variants) */
+  lower = g_utf8_strdown(keyword, -1);
+  lst = strlist_prepend(strlen(lower) <= MAX_STR_LEN ? lower : keyword,
+                        NULL);
+  g_free(lower);
+  if (lst == NULL)
+  {
+    return NULL;
+  }
+  /* e.g. "Mütter" for "Muetter", so that the rules written with umlauts
+     apply */
+  if (strcmp(lang, "de") == 0)
+  {
+    lst = strlist_prepend_umlaut_conversions(lst);
+  }
+  if (strchr(keyword, ' ') == NULL)
+  {
+    start = stats_clock();
+    lst = wforms_add(lst, lang);
+    STATS_TIME(TIMER_WFORMS, start);
+  }
+  for (lst2 = lst; lst2 != NULL; lst2 = lst2->next)
+  {
+    if (dict_normalize_key(lst2->u.str, strlen(lst2->u.str), str) != -1)
+    {
+      free(lst2->u.str);
+      lst2->u.str = xstrdup(str);
+    }
+  }
+  lst = list_sort(lst, str_cmp);
+  lst = list_unique_2(lst, str_cmp, strlist_node_free);
+  STATS_ADD(STAT_VARIANTS, list_length(lst));
   return lst;
 }
 
-void dict_keyword_handle_free(keyword_handle_t handle)
+static struct hashtable *create_norm_table(dict_t *dict,
+                                           struct hashtable *src,
+                                           char **keys, int *keys_len)
 {
-  strlist_free(handle);
+  struct hashtable *h;
+  struct hashtable_itr *itr;
+  list_t *lst;
+  char str[MAX_STR_LEN + 1];
+  char norm_str[MAX_STR_LEN + 1];
+  const char *s;
+  int *offs;
+  int *lens;
+  int s_len, len, i, n, size, used;
+
+  n = hashtable_count(src);
+  if (n == 0)
+  {
+    return NULL;
+  }
+  /* First normalize all the keys, so that *keys doesn't move while the
+     hashtable is built. */
+  offs = (int *) xmalloc(n * sizeof(int));
+  lens = (int *) xmalloc(n * sizeof(int));
+  size = 1024;
+  used = 0;
+  *keys = (char *) xmalloc(size);
+  itr = hashtable_iterator(src);
+  for (i = 0; i < n; ++i, hashtable_iterator_advance(itr))
+  {
+    offs[i] = -1;
+    s = hashtable_iterator_key_s(itr);
+    s_len = hashtable_iterator_key_s_len(itr);
+    if (s_len > MAX_STR_LEN / 2)
+    {
+      continue;
+    }
+    if (dict->converted)
+    {
+      memcpy(str, s, s_len);
+      str[s_len] = '\0';
+    }
+    else if ((s_len = conv_iso_8859_15_to_utf8(s, s_len, str,
+                                               MAX_STR_LEN + 1)) == -1)
+    {
+      continue;
+    }
+    len = dict_normalize_key(str, s_len, norm_str);
+    if (len <= 0)
+    {
+      continue;
+    }
+    while (used + len > size)
+    {
+      size *= 2;
+      *keys = (char *) xrealloc(*keys, size);
+    }
+    memcpy(*keys + used, norm_str, len);
+    offs[i] = used;
+    lens[i] = len;
+    used += len;
+  }
+  free(itr);
+
+  h = hashtable_create(hashtable_min_size(n), *keys, opt_hash_function);
+  if (h == NULL)
+  {
+    free(*keys);
+    *keys = NULL;
+    free(offs);
+    free(lens);
+    return NULL;
+  }
+  *keys_len = used;
+  hashtable_set_arena(h, dict_arena(dict));
+  itr = hashtable_iterator(src);
+  for (i = 0; i < n; ++i, hashtable_iterator_advance(itr))
+  {
+    if (offs[i] == -1)
+    {
+      continue;
+    }
+    s = *keys + offs[i];
+    len = lens[i];
+    lst = hashtable_search(h, s, len);
+    if (lst == NULL)
+    {
+      lst = dict_list_copy_append(dict, hashtable_iterator_value(itr),
+                                  NULL);
+      hashtable_insert(h, offs[i], len, lst);
+    }
+    else
+    { /* keep the head, as the hashtable points to it */
+      lst->next = dict_list_copy_append(dict, hashtable_iterator_value(itr),
+                                        lst->next);
+    }
+  }
+  free(itr);
+  free(offs);
+  free(lens);
+  return h;
+}
+
+static void dict_create_norm_index(dict_t *dict)
+{
+  assert (dict->norm == NULL);
+  if (hashtable_count(dict->hash) == 0)
+  {
+    return;
+  }
+  dict->norm = create_norm_table(dict, dict->hash, &dict->norm_keys,
+                                 &dict->norm_keys_len);
+  if (dict->norm == NULL)
+  {
+    error("Cannot create the normalized keyword index.");
+  }
+}
+
+/* Linking morphemes (Fugenelemente) which may join the parts of a German
+   compound word. */
+static const char *const linking_morphemes[] = { "", "s", "es", "n", "en",
+                                                NULL };
+
+/* Looks up the word s of length len in dict->hash, also with the first
+   letter in upper case, as the parts of a compound other than the first
+   are written in lower case. On success sets itr to the keyword found. */
+static int find_part(dict_t *dict, struct hashtable_itr *itr,
+                     const char *s, int len)
+{
+  unsigned char buf[MAX_STR_LEN + 1];
+  const unsigned char *p = (const unsigned char *) s;
+
+  if (hashtable_iterator_search(itr, dict->hash, s, len))
+  {
+    return 1;
+  }
+  memcpy(buf, s, len);
+  if (p[0] >= 'a' && p[0] <= 'z')
+  {
+    buf[0] = p[0] - 'a' + 'A';
+  }
+  else if (!dict->converted && p[0] >= 0xe0 && p[0] <= 0xfe &&
+           p[0] != 0xf7)
+  { /* ISO-8859-15 à - þ */
+    buf[0] = p[0] - 0x20;
+  }
+  else if (dict->converted && len > 1 && p[0] == 0xc3 && p[1] >= 0xa0 &&
+           p[1] <= 0xbe && p[1] != 0xb7)
+  { /* the same in UTF-8 */
+    buf[1] = p[1] - 0x20;
+  }
+  else
+  {
+    return 0;
+  }
+  return hashtable_iterator_search(itr, dict->hash, (const char *) buf, len);
+}
+
+/* Splits the word s of length len into keywords of dict, possibly joined
+   by linking morphemes, preferring longer parts. n is the number of parts
+   found so far; the keywords are stored in parts and parts_len. Returns
+   the total number of parts, or 0 if s cannot be split. The whole of s is
+   not accepted as the only part. */
+static int split_compound(dict_t *dict, struct hashtable_itr *itr,
+                          const char *s, int len, int n,
+                          const char **parts, int *parts_len)
+{
+  int plen, mlen, i, k;
+
+  for (plen = len - (n == 0 ? MIN_KEYWORD_CHARS : 0);
+       plen >= MIN_KEYWORD_CHARS; --plen)
+  {
+    if (dict->converted && plen < len && (s[plen] & 0xc0) == 0x80)
+    { /* not a UTF-8 character boundary */
+      continue;
+    }
+    if (!find_part(dict, itr, s, plen))
+    {
+      continue;
+    }
+    parts[n] = hashtable_iterator_key_s(itr);
+    parts_len[n] = hashtable_iterator_key_s_len(itr);
+    if (plen == len)
+    {
+      return n + 1;
+    }
+    if (n + 1 == MAX_COMPOUND_PARTS)
+    {
+      continue;
+    }
+    for (i = 0; linking_morphemes[i] != NULL; ++i)
+    {
+      mlen = strlen(linking_morphemes[i]);
+      if (plen + mlen + MIN_KEYWORD_CHARS <= len &&
+          memcmp(s + plen, linking_morphemes[i], mlen) == 0)
+      {
+        k = split_compound(dict, itr, s + plen + mlen, len - plen - mlen,
+                           n + 1, parts, parts_len);
+        if (k != 0)
+        {
+          return k;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/* Returns the sorted indices of the lines containing the keyword s of
+   length len, on its own or in a compound. */
+static list_t *compound_part_lines(dict_t *dict, const char *s, int len)
+{
+  list_t *lst;
+
+  lst = hashtable_search_batch(dict->hash, 1, &s, &len, NULL);
+  lst = hashtable_search_batch(dict->parts, 1, &s, &len, lst);
+  lst = list_sort(lst, line_idx_cmp);
+  return list_unique(lst, line_idx_cmp);
+}
+
+/* Returns the line indices present in both sorted lists l1 and l2, which
+   are freed. */
+static list_t *lines_intersect(list_t *l1, list_t *l2)
+{
+  list_t *lst;
+  list_t **tail;
+  list_t *node;
+
+  lst = NULL;
+  tail = &lst;
+  while (l1 != NULL && l2 != NULL)
+  {
+    if (l1->u.entry_line_idx <= l2->u.entry_line_idx)
+    {
+      node = l1;
+      l1 = l1->next;
+      if (node->u.entry_line_idx == l2->u.entry_line_idx)
+      {
+        *tail = node;
+        tail = &node->next;
+        continue;
+      }
+    }
+    else
+    {
+      node = l2;
+      l2 = l2->next;
+    }
+    list_node_free(node);
+  }
+  *tail = NULL;
+  list_free(l1);
+  list_free(l2);
+  return lst;
+}
+
+static list_t *search_compound_parts(dict_t *dict, const char *s, int len)
+{
+  struct hashtable_itr *itr;
+  const char *parts[MAX_COMPOUND_PARTS];
+  int parts_len[MAX_COMPOUND_PARTS];
+  int i, k, n;
+  unsigned long long start;
+  list_t *lst;
+
+  if (len < 2 * MIN_KEYWORD_CHARS || len > MAX_STR_LEN)
+  {
+    return NULL;
+  }
+  start = stats_clock();
+  itr = hashtable_iterator(dict->hash);
+  n = split_compound(dict, itr, s, len, 0, parts, parts_len);
+  free(itr);
+  lst = NULL;
+  for (k = 0; k < n && lst == NULL; ++k)
+  {
+    lst = compound_part_lines(dict, parts[n - 1], parts_len[n - 1]);
+    for (i = k; i < n - 1 && lst != NULL; ++i)
+    {
+      lst = lines_intersect(lst, compound_part_lines(dict, parts[i],
+                                                     parts_len[i]));
+    }
+  }
+  STATS_TIME(TIMER_LOOKUP, start);
+  return lst;
+}
+
+static void dict_create_parts_index(dict_t *dict)
+{
+  struct hashtable_itr *itr;
+  struct hashtable_itr *itr2;
+  const char *parts[MAX_COMPOUND_PARTS];
+  int parts_len[MAX_COMPOUND_PARTS];
+  list_t *lines;
+  list_t *lst;
+  const char *s;
+  int s_len, i, j, k, n;
+
+  assert (dict->parts == NULL);
+  n = hashtable_count(dict->hash);
+  dict->parts = hashtable_create(n / 4, dict->file->data, opt_hash_function);
+  if (dict->parts == NULL)
+  {
+    error("Cannot create the compound word index.");
+    return;
+  }
+  hashtable_set_arena(dict->parts, dict_arena(dict));
+  itr = hashtable_iterator(dict->hash);
+  itr2 = hashtable_iterator(dict->hash);
+  for (i = 0; i < n; ++i, hashtable_iterator_advance(itr))
+  {
+    s = hashtable_iterator_key_s(itr);
+    s_len = hashtable_iterator_key_s_len(itr);
+    if (s_len < 2 * MIN_KEYWORD_CHARS || s_len > MAX_STR_LEN ||
+        memchr(s, ' ', s_len) != NULL)
+    {
+      continue;
+    }
+    k = split_compound(dict, itr2, s, s_len, 0, parts, parts_len);
+    if (k == 0)
+    {
+      continue;
+    }
+    lines = list_copy(hashtable_iterator_value(itr));
+    for (j = 0; j < k; ++j)
+    {
+      lst = hashtable_search(dict->parts, parts[j], parts_len[j]);
+      if (lst == NULL)
+      {
+        hashtable_insert(dict->parts, parts[j] - dict->file->data,
+                         parts_len[j], dict_list_copy_append(dict, lines,
+                                                             NULL));
+      }
+      else
+      { /* keep the head, as the hashtable points to it */
+        lst->next = dict_list_copy_append(dict, lines, lst->next);
+      }
+    }
+    list_free(lines);
+  }
+  free(itr2);
+  free(itr);
+}
+
+static void dict_create_norm_parts_index(dict_t *dict)
+{
+  int len;
+
+  assert (dict->norm_parts == NULL);
+  if (hashtable_count(dict->parts) == 0)
+  {
+    return;
+  }
+  dict->norm_parts = create_norm_table(dict, dict->parts,
+                                       &dict->norm_parts_keys, &len);
+  if (dict->norm_parts == NULL)
+  {
+    error("Cannot create the normalized compound word index.");
+  }
 }
 
 void dict_free(dict_t *dict)
 {
   assert (dict != NULL);
-  assert (dict->hash != NULL);
   assert (dict->file != NULL);
 
-  hashtable_destroy(dict->hash);
-
+  dict_free_indexes(dict);
   if (--dict->file->ref == 0)
   {
     file_unload(dict->file);
@@ -956,8 +2212,163 @@ list_t *line_idx_to_entry_list(dict_t *dict, int line_idx)
 
 list_t *sort_search_results(list_t *lst)
 {
+  unsigned long long start;
+
+  start = stats_clock();
   lst = list_filter(lst, node_not_strlist_utf8_validate);
   lst = list_sort(lst, lst_cmp);
   lst = list_unique_2(lst, lst_cmp, node_strlist_free);
+  STATS_TIME(TIMER_SORT, start);
+  stats_flush();
   return lst;
 }
+
+static int result_not_utf8_validate(const result_t *r)
+{
+  char *end;
+  char *s;
+  int i;
+
+  for (i = 0; i < r->fields_num; ++i)
+  {
+    s = r->fields[i];
+    if (!g_utf8_validate(s, -1, (const gchar **) &end))
+    {
+      fprintf(stderr, "WARNING: Invalid UTF-8 string.\n");
+      if (end != s)
+      {
+        *end = '\0';
+      }
+      else
+      {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+void sort_results(results_t *res)
+{
+  unsigned long long start;
+
+  start = stats_clock();
+  /* a line is often found through several keywords; it is read only
+     once */
+  results_unique_lines(res);
+  STATS_TIME(TIMER_SORT, start);
+  read_results(res);
+  start = stats_clock();
+  results_sort(res, result_cmp);
+  results_unique(res, result_cmp);
+  STATS_TIME(TIMER_SORT, start);
+  stats_flush();
+}
+
+void read_results(results_t *res)
+{
+  unsigned long long start;
+
+  start = stats_clock();
+  results_materialize(res);
+  results_filter(res, result_not_utf8_validate);
+  STATS_TIME(TIMER_READ, start);
+}
+
+results_t *merge_results(results_t **rs, int n)
+{
+  results_t *res;
+  unsigned long long start;
+
+  start = stats_clock();
+  res = results_merge(rs, n, result_cmp);
+  if (res != NULL)
+  {
+    results_unique(res, result_cmp);
+  }
+  STATS_TIME(TIMER_SORT, start);
+  stats_flush();
+  return res;
+}
+
+/* Moves the heap element at i down to its place. */
+static void heap_sift_down(list_t **heap, int n, int i)
+{
+  list_t *node;
+  int j;
+
+  node = heap[i];
+  while ((j = 2 * i + 1) < n)
+  {
+    if (j + 1 < n && lst_cmp((const list_t **) &heap[j + 1],
+                             (const list_t **) &heap[j]) < 0)
+    {
+      ++j;
+    }
+    if (lst_cmp((const list_t **) &heap[j], (const list_t **) &node) >= 0)
+    {
+      break;
+    }
+    heap[i] = heap[j];
+    i = j;
+  }
+  heap[i] = node;
+}
+
+list_t *merge_search_results(list_t **lsts, int n)
+{
+  list_t **heap;
+  list_t *result;
+  list_t *last;
+  list_t *node;
+  int heap_size, i;
+
+  heap = (list_t **) xmalloc(sizeof(list_t *) * (n + 1));
+  heap_size = 0;
+  for (i = 0; i < n; ++i)
+  {
+    if (lsts[i] != NULL)
+    {
+      heap[heap_size++] = lsts[i];
+    }
+  }
+  for (i = heap_size / 2 - 1; i >= 0; --i)
+  {
+    heap_sift_down(heap, heap_size, i);
+  }
+  result = last = NULL;
+  while (heap_size > 0)
+  {
+    node = heap[0];
+    if (node->next != NULL)
+    {
+      heap[0] = node->next;
+    }
+    else
+    {
+      heap[0] = heap[--heap_size];
+    }
+    heap_sift_down(heap, heap_size, 0);
+    if (last != NULL && lst_cmp((const list_t **) &last,
+                                (const list_t **) &node) == 0)
+    {
+      node->next = NULL;
+      node_strlist_free(node);
+    }
+    else
+    {
+      node->next = NULL;
+      if (last == NULL)
+      {
+        result = node;
+      }
+      else
+      {
+        last->next = node;
+      }
+      last = node;
+    }
+  }
+  free(heap);
+  return result;
+}
@@ -20,18 +20,25 @@
 #ifndef DICTIONARY_H
 #define DICTIONARY_H
 
+#include <pthread.h>
+
 #include "limits.h"
 #include "file.h"
 #include "list.h"
 #include "hashtable.h"
+#include "bloom.h"
+#include "results.h"
 
+/* The number of the bits of dict_forms_options() which hold the options. */
+#define FORMS_OPTIONS_BITS 6
 
 typedef struct Dict_struct{
   struct hashtable *hash;
   /* The hashtable maps keywords (strings pointing into some mmaped file)
   to lists of entry line indices (list_t with entry_line_idx being the
   valid field in the union - see list.h), i.e. a list of indices of the
-  lines which contain a given keyword. */
+  lines which contain a given keyword. It is NULL as long as the
+  dictionary is not indexed (see dict_open_all). */
   char name[MAX_NAME_LEN + 1];
   char langs[MAX_DICT_ENTRIES][MAX_NAME_LEN + 1];
   /* NOTE: Hashtable entries and dictionary entries are two different things.
@@ -49,51 +56,162 @@ typedef struct Dict_struct{
   int converted;
   /* converted: see file_header_t for a detailed description */
   int size;
-  /* size: the number of entries */
+  /* size: the number of entries; only approximate (as given in the file
+  header) until the dictionary is indexed */
   int keywords_num;
   /* keywords_num: the overall number of keywords hashed */
+  struct hashtable *forms;
+  /* forms: NULL, or a hashtable mapping each single-word keyword to the
+  list of lines found by a keyword search for it, i.e. the lines
+  containing any of its word forms, also within compounds if parts is
+  present. It is computed in advance for the options given by
+  dict_forms_options() at that time (stored in forms_options) and may be
+  used only if they have not changed. */
+  int forms_options;
+  bloom_t *bloom;
+  /* bloom: NULL, or a filter containing all the keywords from hash
+  converted to UTF-8; used to skip the lookups of keywords which are
+  certainly not present */
+  struct hashtable *norm;
+  /* norm: NULL, or a hashtable mapping the keywords from hash normalized
+  with dict_normalize_key to the lists of lines containing any of them.
+  Its keys point into norm_keys. It is used by keyword searches instead
+  of trying case and umlaut variants of the keyword, if both
+  opt_ignore_case and opt_german_umlaut_conversion are set. */
+  char *norm_keys;
+  int norm_keys_len;
+  /* norm_keys: NULL if norm has been mapped from the cache file, which
+  then holds its keys as well; norm_keys_len: the length of norm_keys */
+  struct hashtable *parts;
+  /* parts: NULL, or a hashtable mapping keywords of a German dictionary
+  to the lists of lines containing compound words of which they are
+  constituents, e.g. "Bahnhof" to the line of "Hauptbahnhof". Its keys
+  are the same as in hash. */
+  struct hashtable *norm_parts;
+  char *norm_parts_keys;
+  /* norm_parts: NULL, or parts with its keys normalized like those of
+  norm, which are stored in norm_parts_keys; searched instead of parts
+  when norm is. It is never cached, but computed from parts. */
+  arena_t *arena;
+  /* arena: NULL, or the arena holding the entries and the lists of the
+  hashtables built in memory (those not mapped from the cache); they are
+  all freed at once together with it */
+  int cached;
+  /* cached: nonzero if hash has been mapped from the cache file, so that
+  indexing the dictionary again is cheap */
 } dict_t;
 
-typedef list_t *keyword_handle_t;
+typedef struct Keyword_handle{
+  char *keyword; /* dynamically allocated */
+  char *lang; /* dynamically allocated */
+  list_t *variants;
+  /* variants: the strings actually searched for (word forms, umlaut and
+  case conversions); NULL until first needed */
+  list_t *norm_variants;
+  /* norm_variants: the normalized word forms searched for in dict->norm;
+  NULL until first needed */
+  pthread_mutex_t mutex;
+  /* mutex: guards filling in variants and norm_variants, as a handle may
+  be shared by the threads searching different dictionaries */
+} *keyword_handle_t;
 
 typedef enum{SEARCH_KEYWORD, SEARCH_EXACT, SEARCH_REGEX} search_t;
 
-/* dict_create and dict_search use progress_* variables from utils.h,
+/* dict_create_all and dict_search use progress_* variables from utils.h,
    so they should be set to sensible values before calling these two
    functions */
 
-/* Creates a dictionary numbered dict_num in file.
-  Returns NULL on failure. On success increases the
-  reference count of the file given as an argument.*/
-dict_t *dict_create(file_t *file, int dict_num);
+/* Different dictionaries may be searched by different threads at the
+   same time, also with a shared keyword handle, provided that neither
+   dict_search nor dict_search_results is used for keyword searches.
+   Different files may be loaded with dict_create_all or indexed with
+   dict_index_all by different threads at the same time. A dictionary
+   should not be freed while it is searched. */
+
+/* Creates all the dictionaries in file and stores them in dicts, which
+  should have room for MAX_DICTS_IN_FILE of them. The keywords of each
+  line are indexed for all the dictionaries in a single pass, and all of
+  them are cached in one cache file. Returns the number of dictionaries
+  created, or 0 on failure. On success increases the reference count of
+  the file given as an argument by this number; on failure leaves it
+  unchanged. */
+int dict_create_all(file_t *file, dict_t **dicts);
+/* Like dict_create_all, but only reads the file header: the dictionaries
+  get their names, languages and entry orders, but are not indexed and
+  may not be searched until dict_index_all is called for them. The file
+  itself is only mapped, so this is cheap even for large files. Not
+  indexed dictionaries of files not converted to UTF-8 have no names. */
+int dict_open_all(file_t *file, dict_t **dicts);
+/* Indexes the n dictionaries opened from the same file with
+  dict_open_all, mapping their indexes from the cache if possible.
+  Unless they are all the dictionaries of the file, the cache is neither
+  used nor updated. Returns nonzero on success; on failure the
+  dictionaries stay not indexed. */
+int dict_index_all(dict_t **dicts, int n);
+/* Frees the indexes of the n dictionaries, which stay opened and may be
+  indexed again with dict_index_all. They should not be searched at the
+  time. */
+void dict_unindex_all(dict_t **dicts, int n);
 /* All string parameters are assumed to be valid UTF-8.
-  The list returned is a list of lists of dynamically allocated strings and
-  should be freed by the caller (using list_free_2(list, node_strlist_free)).
-  The results returned are neither sorted nor unique and even not guaranteed
-  to be valid UTF-8. One should probably apply list_sort, list_unique_2 and
-  list_filer to them.*/
-list_t *dict_search(dict_t *dict, const char *what, search_t search_type);
+  Adds the lines found to res. The results added are neither sorted nor
+  unique and even not guaranteed to be valid UTF-8. One should probably
+  apply sort_results to them. */
+void dict_search_results(dict_t *dict, const char *what,
+                         search_t search_type, results_t *res);
 /* It is more efficient to use this function when searching the same keyword
    in multiple dictionaries. A keyword handle may be then allocated once
-   for all the dictionaries, dict_search_keyword called for each dictionary
-   separately, and finally the keyword handle freed. */
+   for all the dictionaries, dict_search_keyword_results called for each
+   dictionary separately, and finally the keyword handle freed. */
+void dict_search_keyword_results(dict_t *dict, keyword_handle_t handle,
+                                 results_t *res);
+/* Like dict_search_results and dict_search_keyword_results, but return
+  the results as a list of lists of dynamically allocated strings, which
+  should be freed by the caller (using list_free_2(list,
+  node_strlist_free)). One should probably apply sort_search_results to
+  them. */
+list_t *dict_search(dict_t *dict, const char *what, search_t search_type);
 list_t *dict_search_keyword(dict_t *dict, keyword_handle_t handle);
 /* Allocates a handle for keyword. The handle may then be passed to
    dict_search_keyword. lang is the language keyword is in. */
 keyword_handle_t dict_keyword_handle_new(const char *keyword,
                                          const char *lang);
 void dict_keyword_handle_free(keyword_handle_t handle);
+/* Returns a bitmask of the options which influence the results of keyword
+   searches in its low FORMS_OPTIONS_BITS bits, and a hash of the word
+   formation rules in the others. It is never negative. */
+int dict_forms_options();
 /* Frees the dictionary. Decreases the reference count of the associated
   file. If it drops to zero then frees the file as well. */
 void dict_free(dict_t *dict);
+/* Normalizes the UTF-8 string s of length len for the lookups in
+   dict->norm: applies Unicode case folding and replaces ä, ö, ü with ae,
+   oe, ue (ß is folded to ss). Writes the result to buf, which should be
+   at least MAX_STR_LEN + 1 bytes long. Returns the length of the result,
+   or -1 if it is too long. */
+int dict_normalize_key(const char *s, int len, char *buf);
 
 /* Returns a list of entries present at a given line. line_idx is assumed to
    indicate a valid line with an appropriate number of entries. */
 list_t *line_idx_to_entry_list(dict_t *dict, int line_idx);
 
 /* Sorts results of the most recent search (the argument most recently
-   passed to dict_search is taken into account) and deletes duplicate
-   entries. Returns the sorted list. */
+   passed to dict_search is taken into account), deletes duplicate
+   entries and those which are not valid UTF-8. */
+void sort_results(results_t *res);
+/* Reads the entries of all the results and deletes those which are not
+   valid UTF-8, keeping the order. Afterwards the results no longer need
+   their dictionaries. sort_results does this as well. */
+void read_results(results_t *res);
+/* Makes the functions sorting and merging the results in the calling
+   thread order them as for a search for what in the language lang. */
+void set_search_results_ranking(const char *what, const char *lang);
+/* Merges n result sets sorted by sort_results into one, deleting
+   duplicate entries. The result sets are consumed. */
+results_t *merge_results(results_t **rs, int n);
+/* The same as sort_results and merge_results for the lists returned by
+   dict_search and dict_search_keyword. sort_search_results returns the
+   sorted list. */
 list_t *sort_search_results(list_t *lst);
+list_t *merge_search_results(list_t **lsts, int n);
 
 #endif
@@ -31,11 +31,13 @@
 
 #include "utils.h"
 #include "strutils.h"
+#include "conv.h"
+#include "stats.h"
 #include "file.h"
 
-file_entry_t file_entry[MAX_DICT_ENTRIES];
-int file_entries_read = 0;
-file_header_t file_header;
+THREAD_LOCAL file_entry_t file_entry[MAX_DICT_ENTRIES];
+THREAD_LOCAL int file_entries_read = 0;
+THREAD_LOCAL file_header_t file_header;
 
 file_t *file_load(const char *path)
 {
@@ -213,7 +215,7 @@ int file_read_line(file_t *file, int i, int needs_utf8)
   int j, was_prev_colon;
   const char *s;
   int k, length;
-  const char *str;
+  char str[MAX_ENTRY_LEN + 1];
 
   assert (file != NULL);
   assert (i < file->length);
@@ -285,26 +287,15 @@ int file_read_line(file_t *file, int i, int needs_utf8)
       break;
     }
   } /* end while (k < MAX_DICT_ENTRIES) */
+  STATS_INC(STAT_LINES_READ);
   if (!file->converted && needs_utf8)
   {
+    STATS_INC(STAT_LINES_CONVERTED);
     for (j = 0; j < k; ++j)
     {
-      str = conv_iso_8859_15_to_utf8(file_entry[j].str,
-                                     strlen(file_entry[j].str));
-      if (str == NULL)
-      {
-        return -1;
-      }
-      xstrncpy(file_entry[j].str, str, MAX_ENTRY_LEN);
-      file_entry[j].str[MAX_ENTRY_LEN] = '\0';
-      str = conv_html_to_utf8(file_entry[j].str,
-                              strlen(file_entry[j].str));
-      if (str == NULL)
-      {
-        return -1;
-      }
-      xstrncpy(file_entry[j].str, str, MAX_ENTRY_LEN);
-      file_entry[j].str[MAX_ENTRY_LEN] = '\0';
+      memcpy(str, file_entry[j].str, file_entry[j].s_len);
+      conv_iso_8859_15_html_to_utf8(str, file_entry[j].s_len,
+                                    file_entry[j].str, MAX_ENTRY_LEN + 1);
     }
   }
   file_entries_read = k;
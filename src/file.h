@@ -21,6 +21,7 @@
 #define FILE_H
 
 #include "limits.h"
+#include "utils.h"
 
 typedef struct{
   int converted; /* converted: see header_t below */
@@ -61,9 +62,10 @@ typedef struct{
   int s_len;
 } file_entry_t;
 
-extern file_entry_t file_entry[MAX_DICT_ENTRIES];
-extern int file_entries_read;
-extern file_header_t file_header;
+/* These are per thread. */
+extern THREAD_LOCAL file_entry_t file_entry[MAX_DICT_ENTRIES];
+extern THREAD_LOCAL int file_entries_read;
+extern THREAD_LOCAL file_header_t file_header;
 
 /* Loads a given file into memory.
   NOTE: This may be implemented with memory maps,
@@ -0,0 +1,307 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+#include "gendict.h"
+
+#define DEFAULT_LINES 1000000
+#define DEFAULT_WORDS 3
+#define DEFAULT_VOCABULARY 200000
+#define DEFAULT_ZIPF 1.0
+#define DEFAULT_COMPOUNDS 20
+#define DEFAULT_ANNOTATIONS 25
+#define DEFAULT_SEED 12345
+
+typedef struct{
+  const char *lang;
+  const char **syllables;
+  int syllables_num;
+  const char **annotations;
+  /* annotations: those beginning with '[' are put before the words, as
+     in "[Br.] flat", the others after them */
+  int annotations_num;
+  int capitalize; /* capitalize the nouns */
+} language_t;
+
+typedef struct{
+  char **words; /* ordered by rank */
+  double *cdf; /* cdf[i]: the sum of the frequencies of words[0..i] */
+  int n;
+} vocabulary_t;
+
+static const char *de_syllables[] = {
+  "ab", "an", "auf", "aus", "bahn", "be", "berg", "burg", "da", "der",
+  "ein", "er", "fahr", "feld", "ge", "haus", "hof", "kat", "la", "land",
+  "lich", "mann", "mer", "na", "ner", "ob", "ra", "ro", "sch", "stein",
+  "ta", "te", "ter", "tor", "un", "ver", "wald", "wer", "zeit", "zu",
+  "über", "schön", "größ", "straß", "bäu", "mü"
+};
+static const char *de_annotations[] = {
+  "{m}", "{f}", "{n}", "{pl}", "(ugs.)", "(irr.)", "[österr.]", "[veraltet]"
+};
+static const char *en_syllables[] = {
+  "ar", "ble", "bo", "con", "de", "er", "fin", "ing", "is", "ly", "ment",
+  "ness", "or", "ous", "per", "pre", "ro", "tion", "ter", "un", "ward",
+  "al", "en", "ful", "in", "ex", "ly", "man", "ship", "st", "th", "y"
+};
+static const char *en_annotations[] = {
+  "[Br.]", "[Am.]", "(coll.)", "(irr.)", "(sth.)", "[archaic]"
+};
+
+#define SIZE(a) ((int) (sizeof(a) / sizeof((a)[0])))
+
+static const language_t german = {
+  "de", de_syllables, SIZE(de_syllables), de_annotations,
+  SIZE(de_annotations), 1
+};
+static const language_t english = {
+  "en", en_syllables, SIZE(en_syllables), en_annotations,
+  SIZE(en_annotations), 0
+};
+
+/* xorshift64* */
+static unsigned long long next_random(unsigned long long *r)
+{
+  *r ^= *r >> 12;
+  *r ^= *r << 25;
+  *r ^= *r >> 27;
+  return *r * 2685821657736338717ULL;
+}
+
+/* Returns a random number in [0, n). */
+static unsigned random_below(unsigned long long *r, unsigned n)
+{
+  return (unsigned) (((next_random(r) >> 32) * n) >> 32);
+}
+
+/* Returns a random number in [0, 1). */
+static double random_unit(unsigned long long *r)
+{
+  return (next_random(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void vocabulary_init(vocabulary_t *v, const language_t *lang,
+                            const gendict_t *g, unsigned long long *r)
+{
+  char buf[MAX_STR_LEN];
+  double sum;
+  int i, j, k, len;
+  const char *s;
+
+  v->n = g->vocabulary;
+  v->words = (char **) xmalloc(v->n * sizeof(char *));
+  v->cdf = (double *) xmalloc(v->n * sizeof(double));
+  sum = 0;
+  for (i = 0; i < v->n; ++i)
+  {
+    /* 1 to 4 syllables, 2 or 3 most often */
+    k = 1 + random_below(r, 3) + (random_below(r, 4) == 0);
+    len = 0;
+    for (j = 0; j < k; ++j)
+    {
+      s = lang->syllables[random_below(r, lang->syllables_num)];
+      strcpy(buf + len, s);
+      len += strlen(s);
+    }
+    /* three in five German words are nouns */
+    if (lang->capitalize && i % 5 < 3 && buf[0] >= 'a' && buf[0] <= 'z')
+    {
+      buf[0] += 'A' - 'a';
+    }
+    v->words[i] = xstrdup(buf);
+    sum += 1.0 / pow(i + 1, g->zipf);
+    v->cdf[i] = sum;
+  }
+}
+
+static void vocabulary_free(vocabulary_t *v)
+{
+  int i;
+
+  for (i = 0; i < v->n; ++i)
+  {
+    free(v->words[i]);
+  }
+  free(v->words);
+  free(v->cdf);
+}
+
+/* Returns the rank of a random word. */
+static int vocabulary_sample(const vocabulary_t *v, unsigned long long *r)
+{
+  double u;
+  int lo, hi, mid;
+
+  u = random_unit(r) * v->cdf[v->n - 1];
+  lo = 0;
+  hi = v->n - 1;
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (v->cdf[mid] > u)
+    {
+      hi = mid;
+    }
+    else
+    {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+/* Writes a compound word made of 2 or 3 words of v, e.g. "Hausbahnhof". */
+static void write_compound(FILE *f, const vocabulary_t *v,
+                           unsigned long long *r)
+{
+  const char *s;
+  int i, k;
+
+  k = 2 + (random_below(r, 4) == 0);
+  for (i = 0; i < k; ++i)
+  {
+    s = v->words[vocabulary_sample(v, r)];
+    if (i == 0 && s[0] >= 'a' && s[0] <= 'z')
+    {
+      fputc(s[0] + 'A' - 'a', f);
+      ++s;
+    }
+    else if (i > 0 && s[0] >= 'A' && s[0] <= 'Z')
+    {
+      fputc(s[0] + 'a' - 'A', f);
+      ++s;
+    }
+    fputs(s, f);
+  }
+}
+
+static void write_entry(FILE *f, const gendict_t *g, const language_t *lang,
+                        const vocabulary_t *v, unsigned long long *r)
+{
+  const char *annotation;
+  int i, n;
+
+  annotation = NULL;
+  if ((int) random_below(r, 100) < g->annotations)
+  {
+    annotation = lang->annotations[random_below(r, lang->annotations_num)];
+  }
+  if (annotation != NULL && annotation[0] == '[')
+  {
+    fputs(annotation, f);
+    fputc(' ', f);
+  }
+  /* most entries are single words */
+  n = 1;
+  while (n < g->words && random_below(r, 3) == 0)
+  {
+    ++n;
+  }
+  for (i = 0; i < n; ++i)
+  {
+    if (i > 0)
+    {
+      fputc(' ', f);
+    }
+    if (lang->capitalize && (int) random_below(r, 100) < g->compounds)
+    {
+      write_compound(f, v, r);
+    }
+    else
+    {
+      fputs(v->words[vocabulary_sample(v, r)], f);
+    }
+  }
+  if (annotation != NULL && annotation[0] != '[')
+  {
+    fputc(' ', f);
+    fputs(annotation, f);
+  }
+}
+
+void gendict_defaults(gendict_t *g)
+{
+  g->lines = DEFAULT_LINES;
+  g->entries = 2;
+  g->words = DEFAULT_WORDS;
+  g->vocabulary = DEFAULT_VOCABULARY;
+  g->zipf = DEFAULT_ZIPF;
+  g->compounds = DEFAULT_COMPOUNDS;
+  g->annotations = DEFAULT_ANNOTATIONS;
+  g->seed = DEFAULT_SEED;
+}
+
+int gendict_write(const gendict_t *g, FILE *f)
+{
+  vocabulary_t de;
+  vocabulary_t en;
+  unsigned long long r;
+  unsigned long i;
+  int j;
+
+  assert (g->entries >= 2 && g->entries <= GENDICT_MAX_ENTRIES);
+  assert (g->words >= 1 && g->vocabulary >= 1);
+
+  /* xorshift needs a nonzero state */
+  r = g->seed != 0 ? g->seed : DEFAULT_SEED;
+  vocabulary_init(&de, &german, g, &r);
+  vocabulary_init(&en, &english, g, &r);
+
+  fprintf(f, "UTF8\nde");
+  for (j = 1; j < g->entries; ++j)
+  {
+    fprintf(f, " :: en");
+  }
+  fprintf(f, "\nname :: Synthetic (%lu lines)\ndicts_num :: 2\n", g->lines);
+  for (j = 0; j < 2; ++j)
+  { /* the size is only a hint, capped anyway when the file is read */
+    fprintf(f, "keys :: %d\nsize :: %lu\n", j,
+            g->lines < MAX_DICT_SIZE ? g->lines : MAX_DICT_SIZE);
+  }
+  fprintf(f, "eoh\n\n");
+
+  for (i = 0; i < g->lines; ++i)
+  {
+    for (j = 0; j < g->entries; ++j)
+    {
+      if (j > 0)
+      {
+        fputs(" :: ", f);
+      }
+      if (j == 0)
+      {
+        write_entry(f, g, &german, &de, &r);
+      }
+      else
+      {
+        write_entry(f, g, &english, &en, &r);
+      }
+    }
+    fputc('\n', f);
+  }
+
+  vocabulary_free(&de);
+  vocabulary_free(&en);
+  return !ferror(f);
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  Generation of synthetic dictionary files in the converted (UTF8)
+  format, so that the benchmarks and stress tests may run at any scale
+  without real dictionary files. The words of each language follow
+  Zipf's law, the German entries may contain compound words made of
+  other words of the vocabulary, and the entries may have bracketed
+  annotations, as in dict.cc. The output depends only on the parameters,
+  including the seed.
+*/
+
+#ifndef GENDICT_H
+#define GENDICT_H
+
+#include <stdio.h>
+#include "limits.h"
+
+/* The maximal number of entries in a line. */
+#define GENDICT_MAX_ENTRIES MAX_DICT_ENTRIES
+
+typedef struct{
+  unsigned long lines; /* the number of lines after the header */
+  int entries;
+  /* entries: the number of entries in a line, from 2 to
+     GENDICT_MAX_ENTRIES; the first, German, is the key of the German ->
+     English dictionary, the second, English, of the English -> German
+     one, and the others are further English translations */
+  int words; /* the maximal number of words in an entry */
+  int vocabulary; /* the number of distinct words of each language */
+  double zipf;
+  /* zipf: the exponent of the Zipf distribution of the words; the word of
+     rank r occurs with frequency proportional to 1 / r^zipf, so 0 gives
+     the uniform distribution */
+  int compounds; /* the percentage of German words which are compounds */
+  int annotations; /* the percentage of entries with annotations */
+  unsigned long long seed;
+} gendict_t;
+
+/* Sets the parameters to their default values. */
+void gendict_defaults(gendict_t *g);
+/* Writes the dictionary file described by g to f. Returns 0 on a write
+   error. */
+int gendict_write(const gendict_t *g, FILE *f);
+
+#endif
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * dict2-gendict writes a synthetic dictionary file (see gendict.h).
+ *
+ * Usage: dict2-gendict [-n lines] [-e entries] [-w words] [-v vocabulary]
+ *                      [-z zipf] [-c compounds] [-a annotations]
+ *                      [-s seed] [-o output]
+ *
+ * compounds and annotations are percentages. The file is written to the
+ * standard output unless an output file is given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gendict.h"
+
+/* The size of the output buffer. */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+static void usage()
+{
+  fprintf(stderr,
+          "Usage: dict2-gendict [-n lines] [-e entries] [-w words] "
+          "[-v vocabulary]\n"
+          "                     [-z zipf] [-c compounds] [-a annotations] "
+          "[-s seed] [-o output]\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  gendict_t g;
+  const char *output;
+  const char *arg;
+  FILE *out;
+  int i, ok;
+
+  gendict_defaults(&g);
+  output = NULL;
+  for (i = 1; i < argc; ++i)
+  {
+    if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' ||
+        i + 1 == argc)
+    {
+      usage();
+    }
+    arg = argv[++i];
+    switch (argv[i - 1][1]){
+      case 'n':
+        g.lines = strtoul(arg, NULL, 10);
+        break;
+      case 'e':
+        g.entries = atoi(arg);
+        break;
+      case 'w':
+        g.words = atoi(arg);
+        break;
+      case 'v':
+        g.vocabulary = atoi(arg);
+        break;
+      case 'z':
+        g.zipf = atof(arg);
+        break;
+      case 'c':
+        g.compounds = atoi(arg);
+        break;
+      case 'a':
+        g.annotations = atoi(arg);
+        break;
+      case 's':
+        g.seed = strtoull(arg, NULL, 10);
+        break;
+      case 'o':
+        output = arg;
+        break;
+      default:
+        usage();
+        break;
+    };
+  }
+  if (g.entries < 2 || g.entries > GENDICT_MAX_ENTRIES || g.words < 1 ||
+      g.vocabulary < 1 || g.zipf < 0)
+  {
+    fprintf(stderr, "Error: Bad parameters.\n");
+    return 1;
+  }
+
+  out = stdout;
+  if (output != NULL && (out = fopen(output, "w")) == NULL)
+  {
+    perror(output);
+    return 1;
+  }
+  setvbuf(out, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+  ok = gendict_write(&g, out);
+  if (fclose(out) != 0)
+  {
+    ok = 0;
+  }
+  if (!ok)
+  {
+    perror("Error writing the dictionary file");
+    return 1;
+  }
+  return 0;
+}
@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "paths.h"
 #include "limits.h"
@@ -37,45 +38,89 @@
 #include "options.h"
 #include "dictionary.h"
 #include "cache.h"
+#include "pool.h"
+#include "results_model.h"
+#include "results_cache.h"
+#include "stats.h"
 #include "gui.h"
 
 // the size of a dictionary above which to prompt whether to display or
 // not
-#define DICT_SIZE_PROMPT 1000
 
 static dict_t *dicts[MAX_DICTS + MAX_DICTS_IN_FILE];
 static int dict_active[MAX_DICTS + MAX_DICTS_IN_FILE];
+/* The dictionaries are kept sorted by this, so that they are listed in
+   the order their files were chosen in, whichever is loaded first. */
+static int dict_order[MAX_DICTS + MAX_DICTS_IN_FILE];
+/* when the dictionaries were last searched or indexed */
+static time_t dict_used[MAX_DICTS + MAX_DICTS_IN_FILE];
 static int dicts_num;
+/* the order of the dictionaries of the next file loaded */
+static int next_dict_order = 0;
 
 static int busy = 0; // nonzero if currently within a handler
 
+/* the number of searches remembered in the history of a page */
+#define MAX_HISTORY 100
+/* the minimum time between showing two parts of the results of a search
+   still running, in milliseconds */
+#define STREAM_INTERVAL 50
+/* how often to look for indexes to free, in seconds */
+#define EVICT_INTERVAL 60
+
 #define STRBUF_SIZE 4096
 
 static char strbuf[STRBUF_SIZE + 1];
 
 static void gui_notifier(const char *event);
-static void update_gui();
-static void setup_progress_dialog(const char *text1, const char *text2);
 static void set_cursor(GdkCursorType type);
-static void reset_progressbar(const char *str);
-static void load_dict(const char *filename);
-static void autoload_dicts();
 static void check_for_errors();
+/* Returns the view of the current page, adding a page if there is none. */
 static GtkTreeView *get_current_results_view();
 static void set_current_page_title(const char *text);
 static void add_notebook_page();
-static GtkListStore *init_tree_view_display(unsigned cols);
-static void add_tree_view_row(GtkListStore *list_store, list_t *node);
-static void display_results(GtkListStore *list_store, list_t *lst);
-static void display_not_found(GtkListStore *list_store);
+static void init_tree_view_display(GtkTreeView *view, unsigned cols);
+/* Shows model in view, which takes it over. */
+static void set_results_model(GtkTreeView *view, GtkTreeModel *model);
+/* Returns a model with cols columns and one row saying text. */
+static GtkTreeModel *message_model(unsigned cols, const char *text);
 static void display_dictionary(dict_t *dict);
 static void display_dicts_choice();
-/* The returned list should be freed by the caller. */
+/* Returns a list of the dictionaries chosen (in u.dict). It should be
+   freed by the caller. */
 static list_t *choose_dicts(const char *prompt);
-static int view_progress();
 static void error_box(const char* msg);
-static int ask_yes_no(const char* question);
-static void unload_dict(int dict_num);
+static void unload_dict(dict_t *dict);
+
+/* Background tasks; see below. */
+/* Shows the results of a search of text in the current page, from the
+   results cache if possible. If record is nonzero then the search is
+   added to the history of the page. */
+static void search_dicts(const char *text, search_t search_type,
+                         int record);
+/* Returns the key of a search of text in the dictionaries searched now
+   (see results_cache.h), or NULL if some active dictionaries cannot be
+   searched yet, so that the results should not be cached. */
+static char *search_key(const char *text, search_t search_type);
+static unsigned results_cols(const results_t *res);
+static void history_add(GtkTreeView *view, const char *text,
+                        search_t search_type);
+static void history_go(int step);
+static void load_dicts(list_t *files, int autoload);
+static void autoload_dicts();
+static void index_dicts(int i, int n);
+static void index_active_dicts();
+static int dict_being_indexed(dict_t *dict);
+static gboolean evict_unused_dicts(gpointer dummy);
+static void cancel_tasks(int all);
+static void tasks_changed();
+static void post_progress();
+static gboolean show_progress(gpointer dummy);
+static void update_progress_dialog();
+static gboolean search_task_done(gpointer data);
+static gboolean add_found_results(gpointer data);
+static gboolean add_loaded_dicts(gpointer data);
+static gboolean load_task_done(gpointer data);
 
 void on_dict_toggled(GtkCellRendererToggle* toggle_renderer, gchar* path_str,
                      gpointer dummy);
@@ -115,8 +160,124 @@ static GtkLabel *lang2_label;
 
 static gboolean initialization_complete = FALSE;
 
-static int progress_percent = 0;
-int job_cancelled = 0;
+/*
+  Loading and searching are done by background tasks. The work of a task
+  is run on the worker threads of the pool, and everything that touches
+  the widgets is posted back to the main thread with g_idle_add. The
+  tasks are owned by the main thread, which frees a task when its final
+  callback runs. Idle callbacks of the same priority are dispatched in the
+  order they are added, so the callbacks posted by the workers of a task
+  run before the final one.
+*/
+
+typedef struct Search_task search_task_t;
+
+/* A search in a single dictionary, run by a worker thread. */
+typedef struct{
+  search_task_t *task;
+  dict_t *dict;
+  keyword_handle_t handle;
+  results_t *result; /* sorted with sort_results */
+  volatile int progress; /* in percents */
+  volatile int done;
+  int posted; /* how many of the results were shown while searching */
+  double posted_time; /* when they were last posted */
+} search_job_t;
+
+/* A search started from a results page. */
+struct Search_task{
+  char *text;
+  search_t search_type;
+  keyword_handle_t de_handle;
+  keyword_handle_t en_handle;
+  const char *rank_lang; /* the results are ranked as in this language */
+  search_job_t *jobs;
+  void **args;
+  int jobs_num;
+  /* the page to show the results in; NULL if the page was closed or
+     another search was started in it */
+  GtkTreeView *view;
+  int show_progress; /* whether shown in the progress dialog */
+  int stream; /* whether the results are shown while they are found */
+  GtkTreeModel *model;
+  /* model: NULL, or the model of view showing the results found so far */
+  guint message_id; /* in the statusbar */
+  volatile int cancelled;
+  char *key; /* for the results cache, or NULL */
+  /* set by the worker finishing the last job */
+  results_t *result;
+  unsigned cols;
+};
+
+/* Results found by a job of a search still running, passed to the main
+   thread. */
+typedef struct{
+  search_task_t *task;
+  results_t *res;
+} found_t;
+
+typedef struct Load_task load_task_t;
+
+/* Loading of a single dictionary file, run by a worker thread. */
+typedef struct{
+  load_task_t *task;
+  const char *filename;
+  int order; /* of the dictionaries loaded, see dict_order */
+  dict_t *dicts[MAX_DICTS_IN_FILE];
+  int n;
+  /* dicts: if n is nonzero, the dictionaries opened from the file which
+     are indexed by the job instead of loading it */
+  volatile const char *stage; /* what is being done with the file */
+  volatile int progress; /* in percents */
+  volatile int done;
+} load_job_t;
+
+/* Loading of dictionary files. The files are loaded concurrently. */
+struct Load_task{
+  list_t *files; /* a list of strings */
+  int autoload; /* whether the active dictionaries are set as in options */
+  list_t *active;
+  /* active: when autoloading, a copy of opt_active_list; only the files
+     with an active dictionary are indexed */
+  load_job_t *jobs;
+  void **args;
+  int jobs_num;
+  guint message_id; /* in the statusbar */
+  volatile int cancelled;
+};
+
+/* The dictionaries loaded from a single file, passed to the main
+   thread. */
+typedef struct{
+  load_job_t *job;
+  dict_t *dicts[MAX_DICTS_IN_FILE];
+  int n;
+} loaded_t;
+
+/* A search shown in a page. */
+typedef struct{
+  char *text;
+  search_t search_type;
+} history_item_t;
+
+/* The searches shown in a page, attached to its view as "history". */
+typedef struct{
+  history_item_t items[MAX_HISTORY];
+  int num;
+  int pos; /* of the search shown, or -1 */
+} history_t;
+
+/* The running tasks; used by the main thread only. */
+static GList *search_tasks = NULL;
+static GList *load_tasks = NULL;
+/* nonzero once gtk_main has returned; no widgets may be touched then */
+static int quitting = 0;
+/* nonzero if an update of the progress dialog is posted */
+static volatile gint progress_posted = 0;
+
+/* The search or load job run by the current thread. */
+static THREAD_LOCAL search_job_t *current_job;
+static THREAD_LOCAL load_job_t *current_load_job;
 
 int run_gui(int argc, char** argv)
 {
@@ -133,6 +294,11 @@ int run_gui(int argc, char** argv)
   strbuf[STRBUF_SIZE] = '\0';
   notifier = gui_notifier;
 
+  /* the worker threads post their results with g_idle_add */
+  if (!g_thread_supported())
+  {
+    g_thread_init(NULL);
+  }
   if (gtk_init_check(&argc, &argv) == FALSE)
   {
     return 0;
@@ -250,6 +416,16 @@ int run_gui(int argc, char** argv)
   gtk_window_add_accel_group(GTK_WINDOW(main_window), accel_group);
   gtk_widget_add_accelerator(widget, "activate", accel_group, GDK_d, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
 
+  widget = glade_xml_get_widget(xml, "menuitem_back");
+  accel_group = gtk_accel_group_new();
+  gtk_window_add_accel_group(GTK_WINDOW(main_window), accel_group);
+  gtk_widget_add_accelerator(widget, "activate", accel_group, GDK_bracketleft, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+
+  widget = glade_xml_get_widget(xml, "menuitem_forward");
+  accel_group = gtk_accel_group_new();
+  gtk_window_add_accel_group(GTK_WINDOW(main_window), accel_group);
+  gtk_widget_add_accelerator(widget, "activate", accel_group, GDK_bracketright, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+
   widget = glade_xml_get_widget(xml, "menuitem_options");
   accel_group = gtk_accel_group_new();
   gtk_window_add_accel_group(GTK_WINDOW(main_window), accel_group);
@@ -298,13 +474,24 @@ int run_gui(int argc, char** argv)
 
   initialization_complete = TRUE;
 
+  pool_init(opt_search_threads);
   if (opt_autoload_list != NULL)
   {
     autoload_dicts();
   }
+  g_timeout_add(EVICT_INTERVAL * 1000, evict_unused_dicts, NULL);
 
   gtk_main();
 
+  /* let the running tasks finish and free them */
+  quitting = 1;
+  cancel_tasks(1);
+  pool_cleanup();
+  while (g_main_context_pending(NULL))
+  {
+    g_main_context_iteration(NULL, FALSE);
+  }
+  results_cache_clear();
   for (i = 0; i < dicts_num; ++i)
   {
     dict_free(dicts[i]);
@@ -318,125 +505,37 @@ int run_gui(int argc, char** argv)
 
 static void gui_notifier(const char *event)
 {
+  /* called by the worker threads loading dictionaries */
+  if (current_load_job == NULL)
+  {
+    return;
+  }
   if (strcmp(event, "cache_start") == 0)
   {
-    gtk_label_set_text(progress_dialog_label1, "Caching ");
-    gtk_widget_show_all(GTK_WIDGET(progress_dialog));
-    update_gui();
+    current_load_job->stage = "Caching ";
   }
-  else if (strcmp(event, "cache_finish") == 0)
+  else if (strcmp(event, "forms_start") == 0)
   {
-    gtk_label_set_text(progress_dialog_label1, "Loading ");
-    gtk_widget_show_all(GTK_WIDGET(progress_dialog));
-    update_gui();
+    current_load_job->stage = "Computing word forms ";
   }
-}
-
-static void update_gui()
-{
-  while (gtk_events_pending())
+  else if (strcmp(event, "cache_finish") == 0)
   {
-    gtk_main_iteration();
+    current_load_job->stage = "Loading ";
   }
+  post_progress();
 }
 
 static void set_cursor(GdkCursorType type)
 {
-  GdkCursor *cursor = gdk_cursor_new(type);
-  gdk_window_set_cursor(GTK_WIDGET(main_window)->window, cursor);
-//  gdk_window_set_cursor(GTK_WIDGET(progress_dialog)->window, cursor);
-  gdk_cursor_unref(cursor);
-  update_gui();
-}
-
-static void reset_progressbar(const char *str)
-{
-  progress_percent = 0;
-  gtk_label_set_text(progress_dialog_label2, str);
-  gtk_progress_bar_set_fraction(progress_dialog_progressbar, 0);
-  gtk_widget_show_all(GTK_WIDGET(progress_dialog));
-  update_gui();
-  gtk_widget_show_now(GTK_WIDGET(progress_dialog));
-}
-
-static void setup_progress_dialog(const char *text1, const char *text2)
-{
-  progress_percent = 0;
-  job_cancelled = 0;
-  gtk_widget_show_all(GTK_WIDGET(progress_dialog));
-  update_gui();
-  gtk_window_set_title(GTK_WINDOW(progress_dialog), text1);
-  gtk_label_set_text(progress_dialog_label1, text2);
-  gtk_progress_bar_set_fraction(progress_dialog_progressbar, 0);
-  update_gui();
-  gtk_widget_show_all(GTK_WIDGET(progress_dialog));
-  update_gui();
-}
-
-static void load_dict(const char *filename)
-{
-  file_t *file;
-  int i, n;
-  dict_t *dict;
+  GdkCursor *cursor;
 
-  if (dicts_num >= MAX_DICTS)
-  {
-    error_box("Too many dictionaries loaded.");
-    return;
-  }
-  file = file_load(filename);
-  if (file == NULL)
+  if (GTK_WIDGET(main_window)->window == NULL)
   {
-    check_for_errors();
     return;
   }
-  file_read_header(file);
-  n = file_header.dicts_num;
-  progress_notifier = view_progress;
-  progress_max = 100 / n;
-  for (i = 0; i < n; ++i)
-  {
-    dict = dict_create(file, i);
-    check_for_errors();
-    if (dict == NULL)
-    {
-      return;
-    }
-    dicts[dicts_num] = dict;
-    dict_active[dicts_num] = 1;
-    ++dicts_num;
-  }
-}
-
-static void autoload_dicts()
-{
-  list_t *lst;
-  int n, i;
-
-  setup_progress_dialog("Loading...", "Loading ");
-  gtk_widget_hide_all(GTK_WIDGET(main_window));
-  update_gui();
-
-  n = list_length(opt_autoload_list);
-  lst = opt_autoload_list;
-  progress_max = 100 / n;
-  progress_notifier = view_progress;
-  progress_percent = 0;
-  while (lst != NULL)
-  {
-    reset_progressbar(lst->u.str);
-    load_dict(lst->u.str);
-    lst = lst->next;
-  }
-  for (i = 0; i < dicts_num; ++i)
-  {
-    dict_active[i] = options_check_active(dicts[i]->name);
-  }
-  check_for_errors();
-
-  gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
-  gtk_widget_show_all(GTK_WIDGET(main_window));
-  display_dicts_choice();
+  cursor = gdk_cursor_new(type);
+  gdk_window_set_cursor(GTK_WIDGET(main_window)->window, cursor);
+  gdk_cursor_unref(cursor);
 }
 
 static void check_for_errors()
@@ -450,6 +549,11 @@ static void check_for_errors()
 
 static GtkTreeView *get_current_results_view()
 {
+  if (gtk_notebook_get_n_pages(results_notebook) == 0)
+  {
+    add_notebook_page();
+  }
+
   return GTK_TREE_VIEW(gtk_bin_get_child(GTK_BIN(gtk_notebook_get_nth_page(results_notebook, gtk_notebook_get_current_page(results_notebook)))));
 }
 
@@ -473,6 +577,8 @@ static void add_notebook_page()
 
   results_view = GTK_TREE_VIEW(gtk_tree_view_new());
   gtk_tree_view_set_headers_visible(results_view, FALSE);
+  /* the rows are then read only when they are shown */
+  gtk_tree_view_set_fixed_height_mode(results_view, TRUE);
   g_signal_connect(results_view, "row-activated",
                    G_CALLBACK(on_view_definition_button_clicked), NULL);
 
@@ -488,32 +594,15 @@ static void add_notebook_page()
   gtk_notebook_set_current_page(results_notebook, page_num);
 }
 
-static GtkListStore *init_tree_view_display(unsigned cols)
+static void init_tree_view_display(GtkTreeView *results_view, unsigned cols)
 {
-  GtkTreeView *results_view;
-  GtkTreeModel *model;
   GtkTreeViewColumn *column;
   gint width;
   unsigned i;
-  GType *types;
-  GtkListStore *list_store;
-
-  if (gtk_notebook_get_n_pages(results_notebook) == 0)
-  {
-    add_notebook_page();
-  }
-
-  results_view = get_current_results_view();
 
   // destroy the current model
 
-  model = gtk_tree_view_get_model(results_view);
   gtk_tree_view_set_model(results_view, NULL);
-  if (model != NULL)
-  {
-    gtk_list_store_clear(GTK_LIST_STORE (model));
-      //g_free(model);
-  }
 
   // remove all columns
 
@@ -534,12 +623,29 @@ static GtkListStore *init_tree_view_display(unsigned cols)
                                   gtk_cell_renderer_text_new(),
                                   "text", i,
                                   NULL);
-    gtk_tree_view_column_set_min_width(column, width);
-    gtk_tree_view_column_set_max_width(column, width);
+    gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(column, width);
     gtk_tree_view_append_column (GTK_TREE_VIEW (results_view), column);
   }
+}
+
+static void set_results_model(GtkTreeView *view, GtkTreeModel *model)
+{
+  unsigned long long start;
 
-  // create a list store
+  start = stats_clock();
+  gtk_tree_view_set_model(view, model);
+  g_object_unref(model);
+  STATS_TIME(TIMER_DISPLAY, start);
+  stats_flush();
+}
+
+static GtkTreeModel *message_model(unsigned cols, const char *text)
+{
+  GtkListStore *list_store;
+  GtkTreeIter iter;
+  GType *types;
+  unsigned i;
 
   types = (GType*) xmalloc(sizeof(GType) * cols);
   for (i = 0; i != cols; ++i)
@@ -548,331 +654,1095 @@ static GtkListStore *init_tree_view_display(unsigned cols)
   }
   list_store = gtk_list_store_newv (cols, types);
   free(types);
+  gtk_list_store_append (list_store, &iter);
+  gtk_list_store_set (list_store, &iter,
+                      0, text,
+                      -1);
+  return GTK_TREE_MODEL (list_store);
+}
 
-  return list_store;
+static void display_dictionary(dict_t *dict)
+{
+  GtkTreeView *view;
+
+  assert (dict != NULL);
+
+  view = get_current_results_view();
+  /* cancel the search running in this page */
+  g_object_set_data(G_OBJECT(view), "search-task", NULL);
+  set_current_page_title(dict->name);
+  init_tree_view_display(view, dict->entries_num);
+  if (dict->size == 0)
+  {
+    set_results_model(view, message_model(dict->entries_num,
+                                          "The dictionary is empty"));
+  }
+  else
+  {
+    set_results_model(view, results_model_new_dict(dict));
+  }
 }
 
-static void add_tree_view_row(GtkListStore *list_store, list_t *lst)
+static void display_dicts_choice()
 {
+  int i;
   GtkTreeIter iter;
-  unsigned j;
-
-  assert (lst != NULL);
+  GtkListStore* list_store = gtk_list_store_new (2,
+                                                 G_TYPE_BOOLEAN,
+                                                 G_TYPE_STRING);
 
-  gtk_list_store_append (list_store, &iter);
-  j = 0;
-  while (lst != NULL)
+  for (i = 0; i != dicts_num; ++i)
   {
+    gtk_list_store_append (list_store, &iter);
     gtk_list_store_set (list_store, &iter,
-                        j, lst->u.str,
+                        0, dict_active[i],
+                        1, dicts[i]->name,
                         -1);
-    lst = lst->next;
-    ++j;
   }
+
+  gtk_tree_view_set_model(dicts_view, GTK_TREE_MODEL(list_store));
+}
+
+static void tree_path_free(gpointer path, gpointer dummy)
+{
+  gtk_tree_path_free((GtkTreePath*)(path));
+}
+
+static list_t *choose_dicts(const char *prompt)
+{
+  list_t *dict_list = NULL;
+  int i;
+
+  gtk_label_set_text(list_choose_label, prompt);
+  /* the dictionaries are stored in the model, as more of them may be
+     loaded while the dialog is shown */
+  GtkListStore* list_store = gtk_list_store_new(2, G_TYPE_STRING,
+                                                G_TYPE_POINTER);
+  for (i = 0; i != dicts_num; ++i)
+  {
+    GtkTreeIter iter;
+    gtk_list_store_append(list_store, &iter);
+    gtk_list_store_set(list_store, &iter,
+                       0, dicts[i]->name,
+                       1, dicts[i],
+                       -1);
+  }
+  gtk_tree_view_set_model(list_choose_view, GTK_TREE_MODEL(list_store));
+
+  gtk_widget_show_all(GTK_WIDGET(list_choose_dialog));
+  gint response = gtk_dialog_run(list_choose_dialog);
+  gtk_widget_hide_all(GTK_WIDGET(list_choose_dialog));
+  if (response == GTK_RESPONSE_OK)
+  {
+    GList* list = gtk_tree_selection_get_selected_rows(gtk_tree_view_get_selection(list_choose_view),
+        NULL);
+    GList* node = list;
+    while (node != NULL)
+    {
+      GtkTreeIter iter;
+      gpointer dict;
+      gtk_tree_model_get_iter(GTK_TREE_MODEL(list_store), &iter,
+                              (GtkTreePath*)(node->data));
+      gtk_tree_model_get(GTK_TREE_MODEL(list_store), &iter,
+                         1, &dict,
+                         -1);
+      list_t *ln = list_node_new();
+      ln->u.dict = (dict_t *) dict;
+      ln->next = dict_list;
+      dict_list = ln;
+      node = node->next;
+    }
+    g_list_foreach (list, tree_path_free, NULL);
+    g_list_free (list);
+  }
+  return dict_list;
+}
+
+/* Background tasks */
+
+/* Posts an update of the progress dialog, unless one is already
+   posted. */
+static void post_progress()
+{
+  if (g_atomic_int_compare_and_exchange(&progress_posted, 0, 1))
+  {
+    g_idle_add(show_progress, NULL);
+  }
+}
+
+static gboolean show_progress(gpointer dummy)
+{
+  g_atomic_int_set(&progress_posted, 0);
+  if (!quitting)
+  {
+    update_progress_dialog();
+  }
+  return FALSE;
+}
+
+/* Shows the progress of all the load tasks, or else of the first search
+   task shown in the progress dialog. Hides the dialog if there are none
+   which are not cancelled. */
+static void update_progress_dialog()
+{
+  GList *node;
+  load_task_t *load;
+  load_job_t *job;
+  search_task_t *search;
+  double fraction;
+  int i, n, progress;
+
+  progress = 0;
+  n = 0;
+  job = NULL;
+  for (node = load_tasks; node != NULL; node = node->next)
+  {
+    load = (load_task_t *) node->data;
+    if (load->cancelled)
+    {
+      continue;
+    }
+    for (i = 0; i < load->jobs_num; ++i)
+    {
+      progress += load->jobs[i].done ? 100 :
+          MIN(load->jobs[i].progress, 100);
+      if (job == NULL && !load->jobs[i].done)
+      {
+        job = &load->jobs[i];
+      }
+    }
+    n += load->jobs_num;
+  }
+  if (n != 0)
+  {
+    gtk_window_set_title(GTK_WINDOW(progress_dialog), "Loading...");
+    if (job != NULL)
+    {
+      gtk_label_set_text(progress_dialog_label1, (const char *) job->stage);
+      gtk_label_set_text(progress_dialog_label2, job->filename);
+    }
+    fraction = (double) progress / (100 * n);
+  }
+  else
+  {
+    search = NULL;
+    for (node = search_tasks; node != NULL; node = node->next)
+    {
+      if (((search_task_t *) node->data)->show_progress &&
+          !((search_task_t *) node->data)->cancelled)
+      {
+        search = (search_task_t *) node->data;
+        break;
+      }
+    }
+    if (search == NULL)
+    {
+      gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
+      return;
+    }
+    gtk_window_set_title(GTK_WINDOW(progress_dialog), "Searching...");
+    gtk_label_set_text(progress_dialog_label1, "Searching in ");
+    progress = 0;
+    for (i = 0; i < search->jobs_num; ++i)
+    {
+      progress += search->jobs[i].done ? 100 :
+          MIN(search->jobs[i].progress, 100);
+    }
+    for (i = 0; i < search->jobs_num; ++i)
+    {
+      if (!search->jobs[i].done)
+      {
+        gtk_label_set_text(progress_dialog_label2,
+                           search->jobs[i].dict->name);
+        break;
+      }
+    }
+    fraction = search->jobs_num == 0 ? 1.0 :
+        (double) progress / (100 * search->jobs_num);
+  }
+  gtk_progress_bar_set_fraction(progress_dialog_progressbar, fraction);
+  gtk_widget_show_all(GTK_WIDGET(progress_dialog));
+}
+
+/* Called whenever a task is started or finished. */
+static void tasks_changed()
+{
+  if (quitting)
+  {
+    return;
+  }
+  set_cursor(search_tasks != NULL || load_tasks != NULL ?
+             GDK_WATCH : GDK_LEFT_PTR);
+  update_progress_dialog();
+}
+
+/* Cancels the tasks shown in the progress dialog, or all the tasks if all
+   is nonzero. */
+static void cancel_tasks(int all)
+{
+  GList *node;
+  search_task_t *search;
+
+  for (node = load_tasks; node != NULL; node = node->next)
+  {
+    ((load_task_t *) node->data)->cancelled = 1;
+  }
+  for (node = search_tasks; node != NULL; node = node->next)
+  {
+    search = (search_task_t *) node->data;
+    if (all || search->show_progress)
+    {
+      search->cancelled = 1;
+    }
+  }
+}
+
+/* Searching */
+
+/* Posts the results found by the current job since they were last
+   posted, unless that was less than STREAM_INTERVAL ago. */
+static void post_found_results()
+{
+  search_job_t *job = current_job;
+  found_t *found;
+  GTimeVal tv;
+  double now;
+  int i;
+
+  g_get_current_time(&tv);
+  now = tv.tv_sec + tv.tv_usec / 1000000.0;
+  if (job->task->cancelled || job->result->num == job->posted ||
+      now - job->posted_time < STREAM_INTERVAL / 1000.0)
+  {
+    return;
+  }
+  found = (found_t *) xmalloc(sizeof(found_t));
+  found->task = job->task;
+  found->res = results_new();
+  for (i = job->posted; i < job->result->num; ++i)
+  {
+    results_add(found->res, job->result->items[i].dict,
+                job->result->items[i].line_idx);
+  }
+  job->posted = job->result->num;
+  job->posted_time = now;
+  set_search_results_ranking(job->task->text, job->task->rank_lang);
+  sort_results(found->res);
+  g_idle_add(add_found_results, found);
+}
+
+static int search_job_progress()
+{
+  ++current_job->progress;
+  if (current_job->task->show_progress)
+  {
+    post_progress();
+  }
+  if (current_job->task->stream)
+  {
+    /* regex searches add the results as they find them */
+    post_found_results();
+  }
+  return !current_job->task->cancelled;
+}
+
+static void run_search_job(void *arg)
+{
+  search_job_t *job = (search_job_t *) arg;
+  search_task_t *task = job->task;
+
+  current_job = job;
+  progress_notifier = search_job_progress;
+  progress_max = 100;
+  job->result = results_new();
+  if (task->search_type == SEARCH_KEYWORD)
+  {
+    dict_search_keyword_results(job->dict, job->handle, job->result);
+  }
+  else
+  {
+    dict_search_results(job->dict, task->text, task->search_type,
+                        job->result);
+  }
+  if (!task->cancelled)
+  {
+    set_search_results_ranking(task->text, task->rank_lang);
+    sort_results(job->result);
+  }
+  /* the counts of this worker thread, also those of sorting */
+  stats_flush();
+  job->done = 1;
+  current_job = NULL;
+}
+
+/* Called by the worker finishing the last job of a search. Merges the
+   results and posts them to the main thread. */
+static void finish_search_task(void *arg)
+{
+  search_task_t *task = (search_task_t *) arg;
+  results_t **results;
+  int i;
+
+  task->cols = 1;
+  if (!task->cancelled)
+  {
+    results = (results_t **) xmalloc(sizeof(results_t *) *
+                                     (task->jobs_num + 1));
+    for (i = 0; i < task->jobs_num; ++i)
+    {
+      results[i] = task->jobs[i].result;
+      if (results[i]->num != 0 && task->jobs[i].dict->entries_num > task->cols)
+      {
+        task->cols = task->jobs[i].dict->entries_num;
+      }
+    }
+    if (task->jobs_num != 0)
+    {
+      set_search_results_ranking(task->text, task->rank_lang);
+    }
+    task->result = merge_results(results, task->jobs_num);
+    free(results);
+  }
+  else
+  {
+    for (i = 0; i < task->jobs_num; ++i)
+    {
+      results_free(task->jobs[i].result);
+    }
+  }
+  g_idle_add(search_task_done, task);
+}
+
+/* Called when the page of a search is closed or another search is
+   started in it. */
+static void search_task_detach(gpointer data)
+{
+  search_task_t *task = (search_task_t *) data;
+  task->cancelled = 1;
+  task->view = NULL;
+}
+
+/* Shows more results of a search still running. They are shown in the
+   order they are found; all the results are sorted when it finishes. */
+static gboolean add_found_results(gpointer data)
+{
+  found_t *found = (found_t *) data;
+  search_task_t *task = found->task;
+  unsigned cols;
+  int i;
+
+  if (quitting || task->view == NULL || task->cancelled ||
+      found->res->num == 0)
+  {
+    results_free(found->res);
+  }
+  else if (task->model == NULL)
+  {
+    cols = 1;
+    for (i = 0; i < task->jobs_num; ++i)
+    {
+      if (task->jobs[i].dict->entries_num > cols)
+      {
+        cols = task->jobs[i].dict->entries_num;
+      }
+    }
+    init_tree_view_display(task->view, cols);
+    task->model = results_model_new(found->res, cols);
+    g_object_ref(task->model);
+    set_results_model(task->view, task->model);
+  }
+  else
+  {
+    results_model_append(task->model, found->res);
+  }
+  free(found);
+  return FALSE;
+}
+
+/* Shows the results of a finished search and frees it. */
+static gboolean search_task_done(gpointer data)
+{
+  search_task_t *task = (search_task_t *) data;
+  GtkTreeView *view;
+  guint context_id;
+
+  search_tasks = g_list_remove(search_tasks, task);
+  view = task->view;
+  if (view != NULL)
+  {
+    g_object_steal_data(G_OBJECT(view), "search-task");
+  }
+  if (!quitting)
+  {
+    context_id = gtk_statusbar_get_context_id(statusbar, "default context");
+    gtk_statusbar_remove(statusbar, context_id, task->message_id);
+    if (view != NULL && task->cancelled && task->model != NULL)
+    {
+      /* the results found before the search was cancelled stay shown */
+    }
+    else if (view != NULL)
+    {
+      init_tree_view_display(view, task->cols);
+      if (task->cancelled)
+      {
+        set_results_model(view, message_model(task->cols, "Cancelled"));
+      }
+      else if (task->result != NULL && task->result->num != 0)
+      {
+        if (task->key != NULL)
+        {
+          results_cache_put(task->key, task->result);
+        }
+        set_results_model(view, results_model_new(task->result, task->cols));
+        task->result = NULL;
+      }
+      else
+      {
+        if (task->key != NULL && task->result != NULL)
+        {
+          results_cache_put(task->key, task->result);
+        }
+        set_results_model(view, message_model(task->cols, "Not found"));
+      }
+    }
+  }
+  if (task->model != NULL)
+  {
+    g_object_unref(task->model);
+  }
+  results_free(task->result);
+  free(task->key);
+  dict_keyword_handle_free(task->de_handle);
+  dict_keyword_handle_free(task->en_handle);
+  free(task->jobs);
+  free(task->args);
+  free(task->text);
+  free(task);
+  tasks_changed();
+  if (!quitting)
+  {
+    check_for_errors();
+  }
+  return FALSE;
+}
+
+static char *search_key(const char *text, search_t search_type)
+{
+  char *key;
+  int i, len;
+
+  key = (char *) xmalloc(strlen(text) + 32 * (dicts_num + 2));
+  len = sprintf(key, "%d %d", (int) search_type, dict_forms_options());
+  for (i = 0; i < dicts_num; ++i)
+  {
+    if (dict_active[i])
+    {
+      if (dict_being_indexed(dicts[i]) || dicts[i]->hash == NULL)
+      {
+        free(key);
+        return NULL;
+      }
+      len += sprintf(key + len, " %p", (void *) dicts[i]);
+    }
+  }
+  sprintf(key + len, ":%s", text);
+  return key;
+}
+
+static unsigned results_cols(const results_t *res)
+{
+  unsigned cols;
+  int i;
+
+  cols = 1;
+  for (i = 0; i < res->num; ++i)
+  {
+    if (res->items[i].dict->entries_num > cols)
+    {
+      cols = res->items[i].dict->entries_num;
+    }
+  }
+  return cols;
+}
+
+/* Starts a search of text in the active dictionaries. The results are
+   shown in the current page when it finishes. */
+static void search_dicts(const char *text, search_t search_type,
+                         int record)
+{
+  search_task_t *task;
+  search_job_t *job;
+  GtkTreeView *view;
+  results_t *res;
+  guint context_id;
+  char *key;
+  unsigned cols;
+  int entries;
+  size_t size;
+  int i;
+
+  view = get_current_results_view();
+  if (record)
+  {
+    history_add(view, text, search_type);
+  }
+  context_id = gtk_statusbar_get_context_id(statusbar, "results cache");
+  gtk_statusbar_pop(statusbar, context_id);
+  /* the dictionaries not indexed yet are not searched this time */
+  index_active_dicts();
+  key = search_key(text, search_type);
+  res = key == NULL ? NULL : results_cache_get(key);
+  if (res != NULL)
+  {
+    /* read now, as the model may outlive the dictionaries */
+    read_results(res);
+    /* a search already running in the page is cancelled */
+    g_object_set_data(G_OBJECT(view), "search-task", NULL);
+    set_current_page_title(text);
+    cols = results_cols(res);
+    init_tree_view_display(view, cols);
+    results_cache_stats(&entries, &size);
+    snprintf(strbuf, STRBUF_SIZE,
+             "%d results of %s cached (%d searches, %lu of %d KB)",
+             res->num, text, entries, (unsigned long) size / 1024,
+             opt_results_cache_size);
+    gtk_statusbar_push(statusbar, context_id, strbuf);
+    if (res->num == 0)
+    {
+      results_free(res);
+      set_results_model(view, message_model(cols, "Not found"));
+    }
+    else
+    {
+      set_results_model(view, results_model_new(res, cols));
+    }
+    free(key);
+    return;
+  }
+
+  task = (search_task_t *) xmalloc(sizeof(search_task_t));
+  task->text = xstrdup(text);
+  task->search_type = search_type;
+  task->de_handle = NULL;
+  task->en_handle = NULL;
+  task->rank_lang = NULL;
+  task->jobs = (search_job_t *) xmalloc(sizeof(search_job_t) *
+                                        (dicts_num + 1));
+  task->args = (void **) xmalloc(sizeof(void *) * (dicts_num + 1));
+  task->jobs_num = 0;
+  task->show_progress = search_type == SEARCH_REGEX;
+  task->stream = search_type == SEARCH_REGEX;
+  task->model = NULL;
+  task->cancelled = 0;
+  task->key = key;
+  task->result = NULL;
+  task->cols = 1;
+  for (i = 0; i < dicts_num; ++i)
+  {
+    if (dict_active[i] && !dict_being_indexed(dicts[i]) &&
+        dicts[i]->hash != NULL)
+    {
+      dict_used[i] = time(NULL);
+      job = &task->jobs[task->jobs_num];
+      job->task = task;
+      job->dict = dicts[i];
+      job->handle = NULL;
+      job->result = NULL;
+      job->progress = 0;
+      job->done = 0;
+      job->posted = 0;
+      job->posted_time = 0;
+      if (search_type == SEARCH_KEYWORD)
+      {
+        if (strcmp(dicts[i]->langs[0], "de") == 0)
+        {
+          if (task->de_handle == NULL)
+          {
+            task->de_handle = dict_keyword_handle_new(text, "de");
+          }
+          job->handle = task->de_handle;
+          task->rank_lang = "de";
+        }
+        else
+        {
+          assert (strcmp(dicts[i]->langs[0], "en") == 0);
+          if (task->en_handle == NULL)
+          {
+            task->en_handle = dict_keyword_handle_new(text, "en");
+          }
+          job->handle = task->en_handle;
+          task->rank_lang = "en";
+        }
+      }
+      else
+      {
+        task->rank_lang = dicts[i]->langs[0];
+      }
+      task->args[task->jobs_num] = job;
+      ++task->jobs_num;
+    } // end if (dict_active[i] ...)
+  } // end for
+
+  /* a search already running in the page is cancelled */
+  task->view = view;
+  g_object_set_data_full(G_OBJECT(view), "search-task", task,
+                         search_task_detach);
+  set_current_page_title(text);
+
+  context_id = gtk_statusbar_get_context_id(statusbar, "default context");
+  snprintf(strbuf, STRBUF_SIZE, "Searching %s...", text);
+  task->message_id = gtk_statusbar_push(statusbar, context_id, strbuf);
+
+  search_tasks = g_list_append(search_tasks, task);
+  tasks_changed();
+  pool_run_async(run_search_job, task->args, task->jobs_num,
+                 finish_search_task, task);
+}
+
+/* History */
+
+static void history_free(gpointer data)
+{
+  history_t *history = (history_t *) data;
+  int i;
+
+  for (i = 0; i < history->num; ++i)
+  {
+    free(history->items[i].text);
+  }
+  free(history);
+}
+
+static void history_add(GtkTreeView *view, const char *text,
+                        search_t search_type)
+{
+  history_t *history;
+
+  history = (history_t *) g_object_get_data(G_OBJECT(view), "history");
+  if (history == NULL)
+  {
+    history = (history_t *) xmalloc(sizeof(history_t));
+    history->num = 0;
+    history->pos = -1;
+    g_object_set_data_full(G_OBJECT(view), "history", history,
+                           history_free);
+  }
+  /* the searches one went back from are forgotten */
+  while (history->num > history->pos + 1)
+  {
+    free(history->items[--history->num].text);
+  }
+  if (history->num == MAX_HISTORY)
+  {
+    free(history->items[0].text);
+    memmove(history->items, history->items + 1,
+            sizeof(history_item_t) * (MAX_HISTORY - 1));
+    --history->num;
+  }
+  history->items[history->num].text = xstrdup(text);
+  history->items[history->num].search_type = search_type;
+  history->pos = history->num;
+  ++history->num;
+}
+
+/* Shows again the search step searches after the one shown in the
+   current page (before it if step is negative). */
+static void history_go(int step)
+{
+  GtkTreeView *view;
+  history_t *history;
+  history_item_t *item;
+
+  view = get_current_results_view();
+  history = (history_t *) g_object_get_data(G_OBJECT(view), "history");
+  if (history == NULL || history->pos + step < 0 ||
+      history->pos + step >= history->num)
+  {
+    return;
+  }
+  history->pos += step;
+  item = &history->items[history->pos];
+  gtk_entry_set_text(text_entry, item->text);
+  search_dicts(item->text, item->search_type, 0);
+}
+
+/* Loading */
+
+static int load_job_progress()
+{
+  ++current_load_job->progress;
+  post_progress();
+  return !current_load_job->task->cancelled;
+}
+
+/* Opens the dictionaries of file, indexing them only if one of them is
+   active or if the file is not converted, so that the dictionaries
+   need their indexes for their names. */
+static int open_dicts(load_task_t *task, file_t *file, dict_t **dicts)
+{
+  list_t *lst;
+  int d, n, needed;
+
+  n = dict_open_all(file, dicts);
+  needed = !file->converted;
+  for (d = 0; d < n; ++d)
+  {
+    for (lst = task->active; lst != NULL; lst = lst->next)
+    {
+      if (strcmp(lst->u.str, dicts[d]->name) == 0)
+      {
+        needed = 1;
+      }
+    }
+  }
+  if (n != 0 && needed && !dict_index_all(dicts, n))
+  {
+    /* the file is unloaded by the caller */
+    ++file->ref;
+    for (d = 0; d < n; ++d)
+    {
+      dict_free(dicts[d]);
+    }
+    --file->ref;
+    n = 0;
+  }
+  return n;
 }
 
-static void display_results(GtkListStore *list_store, list_t *lst)
+static void run_load_job(void *arg)
 {
-  list_t *l = lst;
+  load_job_t *job = (load_job_t *) arg;
+  file_t *file;
+  loaded_t *loaded;
+  int n;
 
-  while (l != NULL)
+  current_load_job = job;
+  if (job->n != 0)
+  {
+    progress_notifier = load_job_progress;
+    progress_max = 100 / job->n;
+    if (!job->task->cancelled)
+    {
+      dict_index_all(job->dicts, job->n);
+    }
+    file = NULL;
+  }
+  else
+  {
+    file = job->task->cancelled ? NULL : file_load(job->filename);
+  }
+  if (file != NULL)
   {
-    add_tree_view_row(list_store, l->u.lst);
-    l = l->next;
+    if (file_read_header(file) == -1 || file_header.dicts_num == 0)
+    {
+      n = 1;
+    }
+    else
+    {
+      n = file_header.dicts_num;
+    }
+    progress_notifier = load_job_progress;
+    progress_max = 100 / n;
+    loaded = (loaded_t *) xmalloc(sizeof(loaded_t));
+    loaded->job = job;
+    if (job->task->autoload)
+    {
+      loaded->n = open_dicts(job->task, file, loaded->dicts);
+    }
+    else
+    {
+      loaded->n = dict_create_all(file, loaded->dicts);
+    }
+    if (loaded->n != 0)
+    {
+      /* the dictionaries may be searched before the other files are
+         loaded */
+      g_idle_add(add_loaded_dicts, loaded);
+    }
+    else
+    {
+      file_unload(file);
+      free(loaded);
+    }
   }
+  job->done = 1;
+  post_progress();
+  current_load_job = NULL;
 }
 
-static void display_not_found(GtkListStore *list_store)
+static void finish_load_task(void *arg)
 {
-  GtkTreeIter iter;
-  gtk_list_store_append (list_store, &iter);
-  gtk_list_store_set (list_store, &iter,
-                      0, "Not found",
-                      -1);
+  g_idle_add(load_task_done, arg);
 }
 
-static void display_dictionary(dict_t *dict)
+/* Adds the dictionaries loaded from a file. */
+static gboolean add_loaded_dicts(gpointer data)
 {
-  unsigned cols;
-  int i;
-  GtkListStore *list_store;
-  list_t *lst;
-
-  assert (dict != NULL);
+  loaded_t *loaded = (loaded_t *) data;
+  int i, j, k;
 
-  if (dict->size > DICT_SIZE_PROMPT)
+  for (k = 0; k < loaded->n; ++k)
   {
-    snprintf(strbuf, STRBUF_SIZE,
-             "This will display the whole dictionary (%d entries)."
-             "Are you sure you want to continue?", dict->size);
-    if (!ask_yes_no(strbuf))
+    if (dicts_num >= MAX_DICTS + MAX_DICTS_IN_FILE)
     {
-      return;
+      error("Too many dictionaries loaded.");
+      dict_free(loaded->dicts[k]);
+      continue;
+    }
+    i = dicts_num;
+    while (i > 0 && dict_order[i - 1] > loaded->job->order)
+    {
+      --i;
+    }
+    for (j = dicts_num; j > i; --j)
+    {
+      dicts[j] = dicts[j - 1];
+      dict_active[j] = dict_active[j - 1];
+      dict_order[j] = dict_order[j - 1];
+      dict_used[j] = dict_used[j - 1];
+    }
+    dicts[i] = loaded->dicts[k];
+    dict_order[i] = loaded->job->order;
+    dict_used[i] = time(NULL);
+    if (loaded->job->task->autoload)
+    {
+      dict_active[i] = options_check_active(dicts[i]->name);
+    }
+    else
+    {
+      dict_active[i] = 1;
     }
+    ++dicts_num;
+  }
+  free(loaded);
+  if (!quitting)
+  {
+    /* a dictionary set active in the meantime may not be indexed */
+    index_active_dicts();
+    display_dicts_choice();
+    check_for_errors();
   }
+  return FALSE;
+}
 
-  set_current_page_title(dict->name);
-  cols = dict->entries_num;
+static gboolean load_task_done(gpointer data)
+{
+  load_task_t *task = (load_task_t *) data;
+  guint context_id;
 
-  list_store = init_tree_view_display(cols);
-  i = file_read_header(dict->file);
-  while (i < dict->file->length)
+  load_tasks = g_list_remove(load_tasks, task);
+  if (!quitting)
   {
-    lst = line_idx_to_entry_list(dict, i);
-    if (strlist_utf8_validate(lst))
-    {
-      add_tree_view_row(list_store, lst);
-    }
-    strlist_free(lst);
-    i = file_skip_line(dict->file, i);
+    context_id = gtk_statusbar_get_context_id(statusbar, "default context");
+    gtk_statusbar_remove(statusbar, context_id, task->message_id);
   }
-
-  if (dict->size == 0)
+  strlist_free(task->files);
+  strlist_free(task->active);
+  free(task->jobs);
+  free(task->args);
+  free(task);
+  tasks_changed();
+  if (!quitting)
   {
-    GtkTreeIter iter;
-    gtk_list_store_append (list_store, &iter);
-    gtk_list_store_set (list_store, &iter,
-                        0, "The dictionary is empty",
-                        -1);
+    check_for_errors();
   }
-
-  gtk_tree_view_set_model(get_current_results_view(),
-                          GTK_TREE_MODEL (list_store));
+  return FALSE;
 }
 
-static void display_dicts_choice()
+/* Starts loading the dictionaries from files, which the task takes
+   over. Each file is loaded by a separate job. */
+static void load_dicts(list_t *files, int autoload)
 {
-  int i;
-  GtkTreeIter iter;
-  GtkListStore* list_store = gtk_list_store_new (2,
-                                                 G_TYPE_BOOLEAN,
-                                                 G_TYPE_STRING);
+  load_task_t *task;
+  load_job_t *job;
+  list_t *lst;
+  guint context_id;
+  int n;
+
+  n = list_length(files);
+  task = (load_task_t *) xmalloc(sizeof(load_task_t));
+  task->files = files;
+  task->autoload = autoload;
+  task->active = autoload ? strlist_copy(opt_active_list) : NULL;
+  task->jobs = (load_job_t *) xmalloc(sizeof(load_job_t) * (n + 1));
+  task->args = (void **) xmalloc(sizeof(void *) * (n + 1));
+  task->jobs_num = 0;
+  task->cancelled = 0;
+  for (lst = files; lst != NULL; lst = lst->next)
+  {
+    job = &task->jobs[task->jobs_num];
+    job->task = task;
+    job->filename = lst->u.str;
+    job->order = next_dict_order++;
+    job->n = 0;
+    job->stage = "Loading ";
+    job->progress = 0;
+    job->done = 0;
+    task->args[task->jobs_num] = job;
+    ++task->jobs_num;
+  }
 
-  for (i = 0; i != dicts_num; ++i)
+  context_id = gtk_statusbar_get_context_id(statusbar, "default context");
+  if (n == 1)
   {
-    gtk_list_store_append (list_store, &iter);
-    gtk_list_store_set (list_store, &iter,
-                        0, dict_active[i],
-                        1, dicts[i]->name,
-                        -1);
+    snprintf(strbuf, STRBUF_SIZE, "Loading dictionaries from %s...",
+             files->u.str);
+  }
+  else
+  {
+    snprintf(strbuf, STRBUF_SIZE, "Loading dictionaries...");
   }
+  task->message_id = gtk_statusbar_push(statusbar, context_id, strbuf);
 
-  gtk_tree_view_set_model(dicts_view, GTK_TREE_MODEL(list_store));
+  load_tasks = g_list_append(load_tasks, task);
+  tasks_changed();
+  pool_run_async(run_load_job, task->args, task->jobs_num,
+                 finish_load_task, task);
 }
 
-static void tree_path_free(gpointer path, gpointer dummy)
+static void autoload_dicts()
 {
-  gtk_tree_path_free((GtkTreePath*)(path));
+  load_dicts(strlist_copy(opt_autoload_list), 1);
 }
 
-static list_t *choose_dicts(const char *prompt)
+/* Starts indexing the n dictionaries starting at dicts[i], which should
+   be all the dictionaries loaded from their file. */
+static void index_dicts(int i, int n)
 {
-  list_t *dict_list = NULL;
-  int i;
+  load_task_t *task;
+  load_job_t *job;
+  guint context_id;
+  int d;
+
+  assert (n <= MAX_DICTS_IN_FILE);
+
+  task = (load_task_t *) xmalloc(sizeof(load_task_t));
+  task->files = NULL;
+  task->autoload = 0;
+  task->active = NULL;
+  task->jobs = (load_job_t *) xmalloc(sizeof(load_job_t));
+  task->args = (void **) xmalloc(sizeof(void *));
+  task->jobs_num = 1;
+  task->cancelled = 0;
+  job = &task->jobs[0];
+  job->task = task;
+  job->filename = dicts[i]->file->path;
+  job->order = dict_order[i];
+  for (d = 0; d < n; ++d)
+  {
+    job->dicts[d] = dicts[i + d];
+    dict_used[i + d] = time(NULL);
+  }
+  job->n = n;
+  job->stage = "Indexing ";
+  job->progress = 0;
+  job->done = 0;
+  task->args[0] = job;
 
-  gtk_label_set_text(list_choose_label, prompt);
-  GtkListStore* list_store = gtk_list_store_new(1, G_TYPE_STRING);
-  for (i = 0; i != dicts_num; ++i)
-  {
-    GtkTreeIter iter;
-    gtk_list_store_append(list_store, &iter);
-    gtk_list_store_set(list_store, &iter,
-                       0, dicts[i]->name,
-                       -1);
-  }
-  gtk_tree_view_set_model(list_choose_view, GTK_TREE_MODEL(list_store));
+  context_id = gtk_statusbar_get_context_id(statusbar, "default context");
+  snprintf(strbuf, STRBUF_SIZE, "Indexing dictionaries from %s...",
+           job->filename);
+  task->message_id = gtk_statusbar_push(statusbar, context_id, strbuf);
+
+  load_tasks = g_list_append(load_tasks, task);
+  tasks_changed();
+  pool_run_async(run_load_job, task->args, task->jobs_num,
+                 finish_load_task, task);
+}
 
-  gtk_widget_show_all(GTK_WIDGET(list_choose_dialog));
-  gint response = gtk_dialog_run(list_choose_dialog);
-  gtk_widget_hide_all(GTK_WIDGET(list_choose_dialog));
-  if (response == GTK_RESPONSE_OK)
+/* Starts indexing the files of the active dictionaries which are not
+   indexed yet. The dictionaries of a file are next to each other in
+   dicts. */
+static void index_active_dicts()
+{
+  int i, j, needed;
+
+  for (i = 0; i < dicts_num; i = j)
   {
-    GList* list = gtk_tree_selection_get_selected_rows(gtk_tree_view_get_selection(list_choose_view),
-        NULL);
-    GList* node = list;
-    while (node != NULL)
+    needed = 0;
+    for (j = i; j < dicts_num && dicts[j]->file == dicts[i]->file; ++j)
     {
-      gchar *str = gtk_tree_path_to_string((GtkTreePath*)(node->data));
-      int dict_num = atoi(str);
-      list_t *ln = list_node_new();
-      ln->u.value = dict_num;
-      ln->next = dict_list;
-      dict_list = ln;
-      node = node->next;
-      g_free(str);
+      needed = needed || dict_active[j];
+    }
+    if (needed && !dict_being_indexed(dicts[i]) && dicts[i]->hash == NULL)
+    {
+      index_dicts(i, j - i);
     }
-    g_list_foreach (list, tree_path_free, NULL);
-    g_list_free (list);
   }
-  return dict_list;
 }
 
-static void search_dicts(const char *text, search_t search_type)
+/* Returns nonzero if dict is being indexed by a worker thread; its index
+   may not be used until then. */
+static int dict_being_indexed(dict_t *dict)
 {
-  int i, cols, active_dicts_num, not_found;
-  keyword_handle_t de_handle = NULL;
-  keyword_handle_t en_handle = NULL;
-  list_t *lst;
-  list_t *lst2;
-  GtkListStore *list_store;
-  guint context_id;
-
-  context_id = gtk_statusbar_get_context_id(statusbar, "default context");
-  snprintf(strbuf, STRBUF_SIZE, "Searching %s...", text);
-  gtk_statusbar_push(statusbar, context_id, strbuf);
-  set_current_page_title(text);
-  update_gui();
-  set_cursor(GDK_WATCH);
-
-  if (dicts_num == 0)
-  {
-    list_store = init_tree_view_display(1);
-    display_not_found(list_store);
-    gtk_tree_view_set_model(get_current_results_view(),
-                            GTK_TREE_MODEL(list_store));
-    gtk_statusbar_pop(statusbar, context_id);
-    set_cursor(GDK_LEFT_PTR);
-    update_gui();
-    return;
-  }
+  GList *node;
+  load_task_t *task;
+  int i, d;
 
-  active_dicts_num = 0;
-  for (i = 0; i < dicts_num; ++i)
-  {
-    if (dict_active[i])
-    {
-      ++active_dicts_num;
-      if (search_type == SEARCH_KEYWORD)
-      {
-        if (strcmp(dicts[i]->langs[0], "de") == 0)
-        {
-          if (de_handle == NULL)
-          {
-            de_handle = dict_keyword_handle_new(text, "de");
-          }
-        }
-        else
-        {
-          assert (strcmp(dicts[i]->langs[0], "en") == 0);
-          if (en_handle == NULL)
-          {
-            en_handle = dict_keyword_handle_new(text, "en");
-          }
-        }
-      } // end if (search_type == SEARCH_KEYWORD)
-    } // end if (dict_active[i])
-  } // end for
-  lst = NULL;
-  not_found = 1;
-  if (active_dicts_num != 0)
+  for (node = load_tasks; node != NULL; node = node->next)
   {
-    progress_max = 100 / active_dicts_num;
-    progress_notifier = view_progress;
-    cols = 1;
-    for (i = 0; i < dicts_num; ++i)
+    task = (load_task_t *) node->data;
+    for (i = 0; i < task->jobs_num; ++i)
     {
-      if (dict_active[i])
+      for (d = 0; d < task->jobs[i].n; ++d)
       {
-        gtk_label_set_text(progress_dialog_label2, dicts[i]->name);
-        update_gui();
-        if (search_type == SEARCH_KEYWORD)
-        {
-          if (strcmp(dicts[i]->langs[0], "de") == 0)
-          {
-            lst2 = dict_search_keyword(dicts[i], de_handle);
-          }
-          else
-          {
-            assert (strcmp(dicts[i]->langs[0], "en") == 0);
-            lst2 = dict_search_keyword(dicts[i], en_handle);
-          }
-        }
-        else
-        {
-          lst2 = dict_search(dicts[i], text, search_type);
-        }
-        if (lst2 != NULL && dicts[i]->entries_num > cols)
+        if (task->jobs[i].dicts[d] == dict)
         {
-          cols = dicts[i]->entries_num;
+          return 1;
         }
-        lst = list_append(lst2, lst);
-        check_for_errors();
       }
     }
-    list_store = init_tree_view_display(cols);
-    if (lst != NULL)
-    {
-      not_found = 0;
-    }
-    lst = sort_search_results(lst);
-    display_results(list_store, lst);
-    list_free_2(lst, node_strlist_free);
   }
-  else
+  return 0;
+}
+
+/* Frees the indexes of the files with no active dictionaries which have
+   not been searched for opt_evict_unused_after seconds, if they have
+   been mapped from the cache. The dictionaries stay loaded and are
+   indexed again when set active. */
+static gboolean evict_unused_dicts(gpointer dummy)
+{
+  time_t now;
+  int i, j, unused;
+
+  if (quitting)
   {
-    list_store = init_tree_view_display(1);
+    return FALSE;
   }
-
-  if (not_found)
+  if (opt_evict_unused_after <= 0 || search_tasks != NULL)
   {
-    display_not_found(list_store);
+    return TRUE;
   }
-
-  if (search_type == SEARCH_KEYWORD)
+  now = time(NULL);
+  for (i = 0; i < dicts_num; i = j)
   {
-    dict_keyword_handle_free(de_handle);
-    dict_keyword_handle_free(en_handle);
+    unused = !dict_being_indexed(dicts[i]) && dicts[i]->hash != NULL &&
+        dicts[i]->cached;
+    for (j = i; j < dicts_num && dicts[j]->file == dicts[i]->file; ++j)
+    {
+      unused = unused && !dict_active[j] &&
+          now - dict_used[j] >= opt_evict_unused_after;
+    }
+    if (unused)
+    {
+      dict_unindex_all(dicts + i, j - i);
+    }
   }
-
-  gtk_tree_view_set_model(get_current_results_view(),
-                          GTK_TREE_MODEL(list_store));
-  gtk_statusbar_pop(statusbar, context_id);
-  set_cursor(GDK_LEFT_PTR);
-  update_gui();
+  return TRUE;
 }
 
 static void load_dicts_from_file(const char *filename)
 {
-  guint context_id;
-  setup_progress_dialog("Loading...", "Loading ");
-  reset_progressbar(filename);
-  context_id = gtk_statusbar_get_context_id(statusbar, "default context");
-  snprintf(strbuf, STRBUF_SIZE, "Loading dictionaries from %s...", filename);
-  gtk_statusbar_push(statusbar, context_id, strbuf);
-  update_gui();
-  set_cursor(GDK_WATCH);
-
-  load_dict(filename);
-  check_for_errors();
-
-  gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
-  display_dicts_choice();
-  set_cursor(GDK_LEFT_PTR);
-  gtk_statusbar_pop(statusbar, context_id);
-}
-
-static int view_progress()
-{
-  if (job_cancelled)
-  {
-    gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
-    update_gui();
-    return 0;
-  }
+  list_t *files;
 
-  ++progress_percent;
-  double fraction = (double) progress_percent / 100;
-  if (fraction > 1.0)
+  if (dicts_num >= MAX_DICTS)
   {
-    fraction = 1.0;
+    error_box("Too many dictionaries loaded.");
+    return;
   }
-
-  gtk_progress_bar_set_fraction(progress_dialog_progressbar, fraction);
-  gtk_widget_show_all(GTK_WIDGET(progress_dialog));
-  update_gui();
-  gtk_widget_show_now(GTK_WIDGET(progress_dialog));
-
-  return 1;
+  files = strlist_node_new(filename);
+  files->next = NULL;
+  load_dicts(files, 0);
 }
 
 static void error_box(const char *msg)
@@ -884,40 +1754,26 @@ static void error_box(const char *msg)
   gtk_widget_destroy(error_dialog);
 }
 
-static int ask_yes_no(const char *question)
-{
-  int result;
-  GtkWidget* dialog = gtk_message_dialog_new(main_window, GTK_DIALOG_MODAL,
-                                             GTK_MESSAGE_QUESTION, GTK_BUTTONS_YES_NO,
-                                             "%s", question);
-  result = (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_YES);
-  gtk_widget_destroy(dialog);
-  return result;
-}
-
-static void unload_dict(int dict_num)
+static void unload_dict(dict_t *dict)
 {
-  dict_t *dict;
   int i;
-  guint context_id = gtk_statusbar_get_context_id(statusbar, "default context");
-  snprintf(strbuf, STRBUF_SIZE, "Unloading %s...", dicts[dict_num]->name);
-  gtk_statusbar_push(statusbar, context_id, strbuf);
-  set_cursor(GDK_WATCH);
-  update_gui();
-
-  /* destroy the dictionary */
-  dict = dicts[dict_num];
+
+  i = 0;
+  while (dicts[i] != dict)
+  {
+    ++i;
+  }
   --dicts_num;
-  for (i = dict_num; i < dicts_num; ++i)
+  for (; i < dicts_num; ++i)
   {
     dicts[i] = dicts[i + 1];
     dict_active[i] = dict_active[i + 1];
+    dict_order[i] = dict_order[i + 1];
+    dict_used[i] = dict_used[i + 1];
   }
+  /* the cached results may refer to it */
+  results_cache_clear();
   dict_free(dict);
-
-  gtk_statusbar_pop(statusbar, context_id);
-  set_cursor(GDK_LEFT_PTR);
-  update_gui();
 }
 
 void on_dict_toggled(GtkCellRendererToggle *toggle_renderer, gchar *path_str,
@@ -942,6 +1798,8 @@ void on_dict_toggled(GtkCellRendererToggle *toggle_renderer, gchar *path_str,
   if (dict_active[dict_num])
   {
     options_add_active(dicts[dict_num]->name);
+    /* so that it is ready when searched */
+    index_active_dicts();
   } else
   {
     options_remove_active(dicts[dict_num]->name);
@@ -997,11 +1855,28 @@ void on_unload1_activate(GObject *dummy1, gpointer dummy2)
   }
   busy = 1;
 
+  if (search_tasks != NULL)
+  {
+    /* the dictionaries may be used by the searches */
+    error_box("Cannot unload dictionaries while searching.");
+    busy = 0;
+    return;
+  }
   dict_list = choose_dicts("Choose the dictionary to unload.");
+  for (node = dict_list; node != NULL; node = node->next)
+  {
+    if (dict_being_indexed(node->u.dict))
+    {
+      error_box("Cannot unload dictionaries while they are indexed.");
+      list_free(dict_list);
+      busy = 0;
+      return;
+    }
+  }
   node = dict_list;
   while (node != NULL)
   {
-    unload_dict(node->u.value);
+    unload_dict(node->u.dict);
     node = node->next;
   }
   list_free(dict_list);
@@ -1199,7 +2074,7 @@ void on_find1_clicked(GObject *dummy1, gpointer dummy2)
   text = gtk_entry_get_text(text_entry);
   if (!(text == NULL || strcmp(text, "") == 0))
   {
-    search_dicts(text, SEARCH_KEYWORD);
+    search_dicts(text, SEARCH_KEYWORD, 1);
   }
 
   busy = 0;
@@ -1217,9 +2092,7 @@ void on_find_regex1_clicked(GObject *dummy1, gpointer dummy2)
   text = gtk_entry_get_text(text_entry);
   if (!(text == NULL || strcmp(text, "") == 0))
   {
-    setup_progress_dialog("Searching...", "Searching in ");
-    search_dicts(text, SEARCH_REGEX);
-    gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
+    search_dicts(text, SEARCH_REGEX, 1);
   }
 
   busy = 0;
@@ -1237,7 +2110,7 @@ void on_find_exact_clicked(GObject *dummy1, gpointer dummy2)
   text = gtk_entry_get_text(text_entry);
   if (!(text == NULL || strcmp(text, "") == 0))
   {
-    search_dicts(text, SEARCH_EXACT);
+    search_dicts(text, SEARCH_EXACT, 1);
   }
 
   busy = 0;
@@ -1256,7 +2129,8 @@ void on_clear_cache_button_clicked(GObject *dummy1, gpointer dummy2)
 
 void on_progress_dialog_cancel_button_clicked(GObject *dummy1, gpointer dummy2)
 {
-  job_cancelled = 1;
+  cancel_tasks(0);
+  gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
 }
 
 void on_page_new_activate(GObject *dummy1, gpointer dummy2)
@@ -1277,6 +2151,12 @@ void on_page_close_activate(GObject *dummy1, gpointer dummy2)
     return;
   }
   busy = 1;
+  if (gtk_notebook_get_n_pages(results_notebook) != 0)
+  {
+    /* cancel the search running in the page */
+    g_object_set_data(G_OBJECT(get_current_results_view()), "search-task",
+                      NULL);
+  }
   gtk_notebook_remove_page(results_notebook,
                            gtk_notebook_get_current_page(results_notebook));
   busy = 0;
@@ -1304,6 +2184,52 @@ void on_page_previous_activate(GObject *dummy1, gpointer dummy2)
   busy = 0;
 }
 
+void on_back_activate(GObject *dummy1, gpointer dummy2)
+{
+  if (busy)
+  {
+    return;
+  }
+  busy = 1;
+  history_go(-1);
+  busy = 0;
+}
+
+void on_forward_activate(GObject *dummy1, gpointer dummy2)
+{
+  if (busy)
+  {
+    return;
+  }
+  busy = 1;
+  history_go(1);
+  busy = 0;
+}
+
+void on_statistics_activate(GObject *dummy1, gpointer dummy2)
+{
+  GtkWidget *dialog;
+  char text[STATS_TEXT_SIZE];
+  int entries;
+  size_t size;
+
+  if (busy)
+  {
+    return;
+  }
+  busy = 1;
+  stats_format(text, STATS_TEXT_SIZE);
+  results_cache_stats(&entries, &size);
+  dialog = gtk_message_dialog_new(main_window, GTK_DIALOG_MODAL,
+                                  GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                  "%sresults_cache: %d searches, %lu bytes",
+                                  text, entries, (unsigned long) size);
+  gtk_window_set_title(GTK_WINDOW(dialog), "Statistics");
+  gtk_dialog_run(GTK_DIALOG(dialog));
+  gtk_widget_destroy(dialog);
+  busy = 0;
+}
+
 void on_view_dictionary_activate(GObject *dummy1, gpointer dummy2)
 {
   list_t *list;
@@ -1318,7 +2244,7 @@ void on_view_dictionary_activate(GObject *dummy1, gpointer dummy2)
   list = lst;
   while (lst != NULL)
   {
-    display_dictionary(dicts[lst->u.value]);
+    display_dictionary(lst->u.dict);
     lst = lst->next;
   }
   list_free(list);
@@ -1384,7 +2310,8 @@ void on_search_options_checkbutton_toggled(GObject *dummy1, gpointer dummy2)
 
 gboolean on_progress_dialog_delete()
 {
-  job_cancelled = 1;
+  cancel_tasks(0);
+  gtk_widget_hide_all(GTK_WIDGET(progress_dialog));
   return TRUE;
 }
 
@@ -1427,26 +2354,11 @@ void definition_dialog_close()
 
 void on_quit()
 {
-  int i;
   if (busy)
   {
     return;
   }
-  busy = 1;
-  set_cursor(GDK_WATCH);
-  for (i = 0; i < dicts_num; ++i)
-  {
-    guint context_id = gtk_statusbar_get_context_id(statusbar, "default context");
-    snprintf(strbuf, STRBUF_SIZE, "Unloading %s...", dicts[i]->name);
-    gtk_statusbar_push(statusbar, context_id, strbuf);
-    update_gui();
-    dict_free(dicts[i]);
-    gtk_statusbar_pop(statusbar, context_id);
-    update_gui();
-  }
-  set_cursor(GDK_LEFT_PTR);
-  check_for_errors();
-  dicts_num = 0;
+  /* the dictionaries are freed once the tasks finish */
+  cancel_tasks(1);
   gtk_main_quit();
-  busy = 0;
 }
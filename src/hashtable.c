@@ -4,6 +4,8 @@
 #include "hashtable.h"
 #include "hashtable_private.h"
 #include "fnv.h"
+#include "strhash.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -28,7 +30,8 @@ const float max_load_factor = 0.65;
 
 /*****************************************************************************/
 struct hashtable *
-hashtable_create(unsigned int minsize, const char *file_start)
+hashtable_create(unsigned int minsize, const char *file_start,
+                 int hash_func)
 {
     struct hashtable *h;
     unsigned int pindex, size = primes[0];
@@ -45,22 +48,38 @@ hashtable_create(unsigned int minsize, const char *file_start)
     memset(h->table, 0, size * sizeof(struct entry *));
     h->tablelength  = size;
     h->primeindex   = pindex;
+    h->expansions   = 0;
     h->entrycount   = 0;
     h->loadlimit    = (unsigned int) ceil(size * max_load_factor);
+    h->hash_func    = hash_func;
+    h->seed         = strhash_seed();
     h->file_start   = file_start;
     h->extra_off    = 0;
     h->cache_file   = NULL;
+    h->arena        = NULL;
     h->lst          = NULL;
     return h;
 }
 
+/*****************************************************************************/
+unsigned int
+hashtable_min_size(unsigned int count)
+{
+    return (unsigned int) ceil(count / max_load_factor);
+}
+
 /*****************************************************************************/
 unsigned int
 hash(struct hashtable *h, const char *s, int s_len)
 {
+    unsigned int i;
+    if (h->hash_func == HASH_WYHASH)
+    {
+        return (unsigned int) wyhash(s, s_len, h->seed);
+    }
     /* Aim to protect against poor hash functions by adding logic here
      * - logic taken from java 1.4 hashtable source */
-    unsigned int i = hash_str(s, s_len);
+    i = hash_str(s, s_len);
     i += ~(i << 9);
     i ^=  ((i >> 14) | (i << 18)); /* >>> */
     i +=  (i << 4);
@@ -156,6 +175,7 @@ hashtable_expand(struct hashtable *h)
     }
     h->tablelength = newsize;
     h->loadlimit   = (unsigned int) ceil(newsize * max_load_factor);
+    ++h->expansions;
     return -1;
 }
 
@@ -172,6 +192,22 @@ hashtable_count(struct hashtable *h)
     return h->entrycount;
 }
 
+/*****************************************************************************/
+unsigned int
+hashtable_expansions(struct hashtable *h)
+{
+    return h->expansions;
+}
+
+/*****************************************************************************/
+void
+hashtable_set_arena(struct hashtable *h, arena_t *arena)
+{
+    assert (h->cache_file == NULL);
+    assert (h->entrycount == 0);
+    h->arena = arena;
+}
+
 /*****************************************************************************/
 int
 hashtable_insert(struct hashtable *h, int s_off, int s_len, list_t *v)
@@ -191,8 +227,15 @@ hashtable_insert(struct hashtable *h, int s_off, int s_len, list_t *v)
          * element may be ok. Next time we insert, we'll try expanding again.*/
         hashtable_expand(h);
     }
-    e = (struct entry *)malloc(sizeof(struct entry));
-    if (NULL == e) { --(h->entrycount); return 0; } /*oom*/
+    if (h->arena != NULL)
+    {
+        e = (struct entry *)arena_alloc(h->arena, sizeof(struct entry));
+    }
+    else
+    {
+        e = (struct entry *)malloc(sizeof(struct entry));
+        if (NULL == e) { --(h->entrycount); return 0; } /*oom*/
+    }
     e->h = hash(h,s_off + h->file_start,s_len);
     index = indexFor(h->tablelength,e->h);
     e->s_off = s_off;
@@ -229,6 +272,134 @@ hashtable_search(struct hashtable *h, const char *s, int s_len)
     return NULL;
 }
 
+/*****************************************************************************/
+const int *
+hashtable_search_lines(struct hashtable *h, const char *s, int s_len)
+{
+    struct entry *e;
+    unsigned int hashvalue, index;
+    unsigned long extra_off;
+    const char *fs;
+
+    assert (h->cache_file != NULL);
+
+    hashvalue = hash(h,s,s_len);
+    index = indexFor(h->tablelength,hashvalue);
+    fs = h->file_start;
+    extra_off = h->extra_off;
+    for (e = h->table[index]; e != NULL; e = e->next)
+    {
+        e = (struct entry *) (((char *) e) + extra_off);
+        if ((hashvalue == e->h) && s_len == e->s_len &&
+             memcmp(s, e->s_off + fs, s_len) == 0)
+        {
+          return (const int *) (((char *) e->v) + extra_off);
+        }
+    }
+    return NULL;
+}
+
+/*****************************************************************************/
+/* The number of keys hashtable_search_batch has in flight at a time. */
+#define SEARCH_BATCH 16
+
+static list_t *
+copy_value_append(struct hashtable *h, void *v, list_t *lst)
+{
+  int *vv;
+  list_t *node;
+  list_t *first;
+
+  if (h->cache_file == NULL)
+  {
+    STATS_ADD(STAT_POSTINGS, list_length((list_t *) v));
+    return list_copy1_append((list_t *) v, lst);
+  }
+  vv = (int *) (((char *) v) + h->extra_off);
+  assert (*vv != 0);
+  STATS_INC(STAT_POSTINGS);
+  first = node = list_node_new();
+  node->u.entry_line_idx = *vv;
+  ++vv;
+  while (*vv != 0)
+  {
+    STATS_INC(STAT_POSTINGS);
+    node->next = list_node_new();
+    node = node->next;
+    node->u.entry_line_idx = *vv;
+    ++vv;
+  }
+  node->next = lst;
+  return first;
+}
+
+list_t *
+hashtable_search_batch(struct hashtable *h, int n, const char **s,
+                       const int *s_len, list_t *lst)
+{
+    unsigned int hashvalue[SEARCH_BATCH];
+    struct entry *ent[SEARCH_BATCH];
+    struct entry *e;
+    unsigned long extra_off;
+    const char *fs;
+    int i, j, m;
+
+    fs = h->file_start;
+    extra_off = h->extra_off;
+    STATS_ADD(STAT_PROBES, n);
+    for (j = 0; j < n; j += SEARCH_BATCH)
+    {
+        m = n - j < SEARCH_BATCH ? n - j : SEARCH_BATCH;
+        for (i = 0; i < m; ++i)
+        {
+            hashvalue[i] = hash(h, s[j + i], s_len[j + i]);
+            PREFETCH(&h->table[indexFor(h->tablelength, hashvalue[i])]);
+        }
+        for (i = 0; i < m; ++i)
+        {
+            ent[i] = h->table[indexFor(h->tablelength, hashvalue[i])];
+            if (ent[i] != NULL)
+            {
+                ent[i] = (struct entry *) (((char *) ent[i]) + extra_off);
+                PREFETCH(ent[i]);
+            }
+        }
+        /* Find the first entry with a matching hash and prefetch its key. */
+        for (i = 0; i < m; ++i)
+        {
+            e = ent[i];
+            while (e != NULL && (hashvalue[i] != e->h ||
+                                 s_len[j + i] != e->s_len))
+            {
+                e = e->next == NULL ? NULL :
+                  (struct entry *) (((char *) e->next) + extra_off);
+            }
+            ent[i] = e;
+            if (e != NULL)
+            {
+                PREFETCH(e->s_off + fs);
+            }
+        }
+        for (i = 0; i < m; ++i)
+        {
+            e = ent[i];
+            while (e != NULL)
+            {
+                if (hashvalue[i] == e->h && s_len[j + i] == e->s_len &&
+                    memcmp(s[j + i], e->s_off + fs, s_len[j + i]) == 0)
+                {
+                    STATS_INC(STAT_HITS);
+                    lst = copy_value_append(h, e->v, lst);
+                    break;
+                }
+                e = e->next == NULL ? NULL :
+                  (struct entry *) (((char *) e->next) + extra_off);
+            }
+        }
+    }
+    return lst;
+}
+
 /*****************************************************************************/
 list_t * /* returns value associated with key */
     hashtable_remove(struct hashtable *h, const char *s, int s_len)
@@ -256,7 +427,10 @@ list_t * /* returns value associated with key */
             *pE = e->next;
             h->entrycount--;
             v = e->v;
-            free(e);
+            if (h->arena == NULL)
+            {
+                free(e);
+            }
             return hashtable_get_list_from_value(h, v);
         }
         pE = &(e->next);
@@ -276,7 +450,8 @@ hashtable_destroy(struct hashtable *h)
       struct entry *e, *f;
       struct entry **table = h->table;
       assert (h->extra_off == 0);
-      for (i = 0; i < h->tablelength; i++)
+      /* entries allocated from an arena go away with the arena */
+      for (i = 0; h->arena == NULL && i < h->tablelength; i++)
       {
         e = table[i];
         while (NULL != e)
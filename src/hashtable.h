@@ -5,6 +5,7 @@
 #define __HASHTABLE_CWC22_H__
 
 #include "list.h"
+#include "arena.h"
 
 struct hashtable;
 
@@ -32,17 +33,32 @@ struct hashtable;
  * @param   file_start      a pointer to the mmapped file which holds
                             the strings that may be stored in this
                             hashtable
+ * @param   hash_func       the hash function to use for the keys
+                            (HASH_* from strhash.h)
  * @return                  newly created non-cached hashtable or NULL on
                             failure
  */
 
 struct hashtable *
-hashtable_create(unsigned int minsize, const char *file_start);
+hashtable_create(unsigned int minsize, const char *file_start,
+                 int hash_func);
+
+/* Returns the minsize for hashtable_create with which the hashtable holds
+   count entries without expanding. */
+unsigned int
+hashtable_min_size(unsigned int count);
 
 /* Returns nonzero if the hashtable is cached. */
 int
 hashtable_is_cached(struct hashtable *h);
 
+/* Makes h allocate its entries from arena, which must then also hold the
+   values inserted into h. hashtable_destroy leaves both to the owner of
+   arena, which frees them all at once. Must be called before the first
+   insertion. */
+void
+hashtable_set_arena(struct hashtable *h, arena_t *arena);
+
 /*****************************************************************************
  * hashtable_insert
   Precondition: ! hashtable_is_cached(h)
@@ -85,6 +101,48 @@ hashtable_insert(struct hashtable *h, int s_off, int s_len, list_t *v);
 list_t *
 hashtable_search(struct hashtable *h, const char *s, int s_len);
 
+/*****************************************************************************
+ * hashtable_search_lines
+  Precondition: hashtable_is_cached(h)
+
+ * @name        hashtable_search_lines
+ * @param   h   the hashtable to search
+ * @param   s      the key - does not claim ownership; need not be
+ *                 zero-terminated
+ * @param   s_len  the length of s
+ * @return      the zero-terminated array of the entry line indices
+ *              associated with the key, or NULL if none found
+ * The array points straight into the mapped cache file, so nothing is
+ * allocated and, unlike with hashtable_search, it stays valid until h is
+ * destroyed, whatever other calls are made.
+ */
+
+const int *
+hashtable_search_lines(struct hashtable *h, const char *s, int s_len);
+
+/*****************************************************************************
+ * hashtable_search_batch
+
+ * @name        hashtable_search_batch
+ * @param   h      the hashtable to search
+ * @param   n      the number of keys
+ * @param   s      the keys - does not claim ownership; need not be
+ *                 zero-terminated
+ * @param   s_len  the lengths of the keys
+ * @param   lst    the list to prepend the results to
+ * @return      lst with copies of the lists associated with the keys
+ *              prepended, in the order of the keys (so that the list for
+ *              s[n - 1] comes first)
+ * All the keys are hashed and their buckets prefetched before any chain is
+ * walked, so the cache misses for different keys overlap. Unlike
+ * hashtable_search, this doesn't invalidate the list returned by the
+ * last hashtable_search.
+ */
+
+list_t *
+hashtable_search_batch(struct hashtable *h, int n, const char **s,
+                       const int *s_len, list_t *lst);
+
 /*****************************************************************************
  * hashtable_remove
   Precondition: ! hashtable_is_cached(h)
@@ -111,6 +169,11 @@ hashtable_remove(struct hashtable *h, const char *s, int s_len);
 unsigned int
 hashtable_count(struct hashtable *h);
 
+/* Returns the number of times the hashtable has expanded since it was
+   created. */
+unsigned int
+hashtable_expansions(struct hashtable *h);
+
 
 /*****************************************************************************
  * hashtable_destroy
@@ -28,7 +28,7 @@ hashtable_iterator(struct hashtable *h)
     {
         if (NULL != h->table[i])
         {
-            itr->e = h->table[i];
+            itr->e = (struct entry *) (((char *) h->table[i]) + h->extra_off);
             itr->index = i;
             break;
         }
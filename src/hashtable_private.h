@@ -32,6 +32,9 @@ struct hashtable {
     unsigned int entrycount;
     unsigned int loadlimit;
     unsigned int primeindex;
+    unsigned int expansions; /* the number of times the table has grown */
+    int hash_func; /* HASH_* from strhash.h */
+    unsigned long long seed; /* the seed of hash_func */
     const char *file_start; /* A pointer to the start of the mmapped file
                             where the keys reside. */
     unsigned long extra_off;
@@ -43,6 +46,10 @@ struct hashtable {
     entries are actually mmapped (see cache.h). This file is different from
     file_start - these are two separate files. cache_file is used to cache
     entry structures, file_start holds the keys. */
+    arena_t *arena;
+    /* arena: NULL, or the arena the entries and their values are allocated
+       from; they are then freed together with the arena, not with the
+       hashtable */
     list_t *lst;
     /* lst: the list most recently returned by hashtable_search;
        it is dynamically allocated; this field is used only if the hashtable
@@ -84,6 +91,13 @@ indexFor(unsigned int tablelength, unsigned int hashvalue)
 }
 */
 
+/*****************************************************************************/
+#ifdef __GNUC__
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr)
+#endif
+
 /*****************************************************************************/
 /*#define freekey(X) free(X)*/
 #define freekey(X) ;
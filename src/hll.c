@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include <math.h>
+#include "strhash.h"
+#include "hll.h"
+
+void hll_clear(hll_t *h)
+{
+  memset(h->reg, 0, HLL_REGISTERS);
+}
+
+void hll_add(hll_t *h, const char *s, int s_len)
+{
+  unsigned long long x;
+  unsigned i;
+  unsigned char rank;
+
+  x = wyhash(s, s_len, 0);
+  i = (unsigned) (x >> (64 - HLL_LOG2_REGISTERS));
+  /* the rank is the position of the first 1 bit in the remaining bits */
+  x <<= HLL_LOG2_REGISTERS;
+  rank = 1;
+  while (rank <= 64 - HLL_LOG2_REGISTERS && (x & (1ULL << 63)) == 0)
+  {
+    ++rank;
+    x <<= 1;
+  }
+  if (rank > h->reg[i])
+  {
+    h->reg[i] = rank;
+  }
+}
+
+double hll_count(const hll_t *h)
+{
+  const double m = HLL_REGISTERS;
+  double sum, e;
+  int i, zeros;
+
+  sum = 0;
+  zeros = 0;
+  for (i = 0; i < HLL_REGISTERS; ++i)
+  {
+    sum += ldexp(1.0, -h->reg[i]);
+    if (h->reg[i] == 0)
+    {
+      ++zeros;
+    }
+  }
+  e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  if (e <= 2.5 * m && zeros != 0)
+  { /* small range correction - linear counting */
+    e = m * log(m / zeros);
+  }
+  return e;
+}
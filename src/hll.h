@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  HyperLogLog sketches, which estimate the number of distinct strings
+  added to them in a small fixed amount of memory, with a standard error
+  of about 1.6%.
+*/
+
+#ifndef HLL_H
+#define HLL_H
+
+#define HLL_LOG2_REGISTERS 12
+#define HLL_REGISTERS (1 << HLL_LOG2_REGISTERS)
+
+typedef struct{
+  unsigned char reg[HLL_REGISTERS];
+} hll_t;
+
+/* Makes h empty. */
+void hll_clear(hll_t *h);
+void hll_add(hll_t *h, const char *s, int s_len);
+/* Returns an estimate of the number of distinct strings added to h. */
+double hll_count(const hll_t *h);
+
+#endif
@@ -30,6 +30,7 @@
 #define MAX_FILES 10
 #define MAX_DICTS 50
 #define MAX_DICT_SIZE 1000000
+#define MAX_WFORMS_CACHE_SIZE 256
 
 #define MIN_KEYWORD_CHARS 4
 
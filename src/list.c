@@ -24,8 +24,9 @@
 
 /* Static variables */
 
-static list_t *list_pool = NULL;
-static int list_pool_size = 0;
+/* Each thread has its own pool of free nodes. */
+static THREAD_LOCAL list_t *list_pool = NULL;
+static THREAD_LOCAL int list_pool_size = 0;
 
 #ifdef DEBUG
 static int lst_new = 0;
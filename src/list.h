@@ -25,6 +25,7 @@
 /* Init & Cleanup */
 
 void list_init();
+/* Frees the pool of free nodes of the calling thread. */
 void list_cleanup();
 
 /* Lists */
@@ -24,6 +24,7 @@
 
 #include "paths.h"
 #include "list.h"
+#include "strhash.h"
 #include "options.h"
 
 list_t *opt_autoload_list = NULL;
@@ -35,6 +36,14 @@ int opt_search_inflections = 1;
 int opt_search_stem = 0;
 int opt_caching = 1;
 int opt_cache_min_file_size = 512 * 1024;
+int opt_precompute_forms = 0;
+int opt_hash_function = HASH_WYHASH;
+int opt_normalized_index = 0;
+int opt_decompound = 0;
+int opt_search_threads = 0;
+int opt_estimate_index_size = 1;
+int opt_evict_unused_after = 600;
+int opt_results_cache_size = 4096;
 
 
 void options_set_defaults()
@@ -57,6 +66,14 @@ void options_set_defaults()
   opt_search_stem = 0;
   opt_caching = 1;
   opt_cache_min_file_size = 512 * 1024;
+  opt_precompute_forms = 0;
+  opt_hash_function = HASH_WYHASH;
+  opt_normalized_index = 0;
+  opt_decompound = 0;
+  opt_search_threads = 0;
+  opt_estimate_index_size = 1;
+  opt_evict_unused_after = 600;
+  opt_results_cache_size = 4096;
 }
 
 void options_read_from_file(const char *path)
@@ -176,6 +193,72 @@ void options_read_from_file(const char *path)
         continue;
       }
     }
+    else if (strcmp(str + i, "precompute_forms") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_precompute_forms) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "hash_function") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_hash_function) != 1 ||
+          opt_hash_function < 0 || opt_hash_function >= HASH_FUNCS_NUM)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        opt_hash_function = HASH_WYHASH;
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "normalized_index") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_normalized_index) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "decompound") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_decompound) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "search_threads") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_search_threads) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "estimate_index_size") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_estimate_index_size) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "evict_unused_after") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_evict_unused_after) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
+    else if (strcmp(str + i, "results_cache_size") == 0)
+    {
+      if (sscanf(str + i + len + 1, "%d", &opt_results_cache_size) != 1)
+      {
+        fprintf(stderr, "Bad configuration file format.");
+        continue;
+      }
+    }
   } // end while fgets
   fclose(f);
 }
@@ -214,6 +297,14 @@ void options_save_to_file(const char *path)
   fprintf(f, "search_stem %d\n", opt_search_stem);
   fprintf(f, "caching %d\n", opt_caching);
   fprintf(f, "cache_min_file_size %d\n", opt_cache_min_file_size);
+  fprintf(f, "precompute_forms %d\n", opt_precompute_forms);
+  fprintf(f, "hash_function %d\n", opt_hash_function);
+  fprintf(f, "normalized_index %d\n", opt_normalized_index);
+  fprintf(f, "decompound %d\n", opt_decompound);
+  fprintf(f, "search_threads %d\n", opt_search_threads);
+  fprintf(f, "estimate_index_size %d\n", opt_estimate_index_size);
+  fprintf(f, "evict_unused_after %d\n", opt_evict_unused_after);
+  fprintf(f, "results_cache_size %d\n", opt_results_cache_size);
   fclose(f);
 }
 
@@ -31,6 +31,33 @@ extern int opt_search_inflections;
 extern int opt_search_stem;
 extern int opt_caching;
 extern int opt_cache_min_file_size;
+/* If nonzero then the word forms of all keywords are computed in advance
+   and stored in the cache (see dictionary.h). This is done only for the
+   files which are cached, i.e. if opt_caching is nonzero and the file
+   is at least opt_cache_min_file_size bytes long. The cache is made anew
+   whenever the options influencing the word forms change. */
+extern int opt_precompute_forms;
+/* The hash function of newly built hashtables (HASH_* from strhash.h). */
+extern int opt_hash_function;
+/* If nonzero then each dictionary gets a case folded and umlaut
+   normalized keyword index (see dictionary.h). */
+extern int opt_normalized_index;
+/* If nonzero then German compound words are split into their parts, which
+   are indexed as well (see dictionary.h). */
+extern int opt_decompound;
+/* The number of threads searching the dictionaries; 0 means as many as
+   there are processors. */
+extern int opt_search_threads;
+/* If nonzero then the number of keywords is estimated before building
+   an index, so that its hashtable need not grow while it is built. */
+extern int opt_estimate_index_size;
+/* The number of seconds after which the indexes of inactive dictionaries
+   not searched since then are freed, if they have been mapped from the
+   cache (so that mapping them again is cheap); 0 means never. */
+extern int opt_evict_unused_after;
+/* The maximal size of the results of recent searches kept in memory, in
+   kilobytes (see results_cache.h). */
+extern int opt_results_cache_size;
 
 void options_set_defaults();
 void options_read_from_file(const char *path);
@@ -0,0 +1,252 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "utils.h"
+#include "list.h"
+#include "pool.h"
+
+/* The maximal number of worker threads. */
+#define MAX_POOL_THREADS 16
+
+struct Pool_batch{
+  pool_func_t func;
+  void **args;
+  int n;
+  int next; /* the next job to take */
+  int done; /* the number of jobs finished */
+  pool_func_t done_func; /* NULL if the batch is waited for */
+  void *done_arg;
+  struct Pool_batch *next_batch; /* in the queue */
+};
+
+static pthread_t threads[MAX_POOL_THREADS];
+static int threads_num = 0;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+/* signalled when a batch is queued or the pool is stopped */
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+/* signalled when a batch is finished */
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+/* the batches with jobs not yet taken, oldest first */
+static struct Pool_batch *first_batch = NULL;
+static struct Pool_batch *last_batch = NULL;
+/* the number of batches not yet finished */
+static int batches_running = 0;
+static int stopping = 0;
+
+static struct Pool_batch *batch_new(pool_func_t func, void **args, int n,
+                                    pool_func_t done, void *done_arg);
+static int batch_start(struct Pool_batch *b);
+
+static void *worker(void *dummy)
+{
+  struct Pool_batch *b;
+  int i;
+
+  pthread_mutex_lock(&mutex);
+  for (;;)
+  {
+    while (!stopping && first_batch == NULL)
+    {
+      pthread_cond_wait(&work_cond, &mutex);
+    }
+    if (stopping)
+    {
+      break;
+    }
+    b = first_batch;
+    i = b->next++;
+    if (b->next == b->n)
+    {
+      first_batch = b->next_batch;
+      if (first_batch == NULL)
+      {
+        last_batch = NULL;
+      }
+    }
+    pthread_mutex_unlock(&mutex);
+    b->func(b->args[i]);
+    pthread_mutex_lock(&mutex);
+    if (++b->done == b->n)
+    {
+      if (b->done_func != NULL)
+      {
+        pthread_mutex_unlock(&mutex);
+        b->done_func(b->done_arg);
+        free(b);
+        pthread_mutex_lock(&mutex);
+      }
+      --batches_running;
+      pthread_cond_broadcast(&done_cond);
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+  list_cleanup();
+  return NULL;
+}
+
+static struct Pool_batch *batch_new(pool_func_t func, void **args, int n,
+                                    pool_func_t done, void *done_arg)
+{
+  struct Pool_batch *b;
+
+  b = (struct Pool_batch *) xmalloc(sizeof(struct Pool_batch));
+  b->func = func;
+  b->args = args;
+  b->n = n;
+  b->next = 0;
+  b->done = 0;
+  b->done_func = done;
+  b->done_arg = done_arg;
+  b->next_batch = NULL;
+  return b;
+}
+
+/* Queues b, or runs it at once if there are no threads, in which case
+   returns nonzero. */
+static int batch_start(struct Pool_batch *b)
+{
+  int i;
+
+  if (threads_num == 0 || b->n == 0)
+  {
+    for (i = 0; i < b->n; ++i)
+    {
+      b->func(b->args[i]);
+    }
+    b->next = b->done = b->n;
+    return 1;
+  }
+  pthread_mutex_lock(&mutex);
+  if (last_batch == NULL)
+  {
+    first_batch = b;
+  }
+  else
+  {
+    last_batch->next_batch = b;
+  }
+  last_batch = b;
+  ++batches_running;
+  pthread_cond_broadcast(&work_cond);
+  pthread_mutex_unlock(&mutex);
+  return 0;
+}
+
+void pool_init(int n)
+{
+  int i;
+
+  if (n <= 0)
+  {
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (n > MAX_POOL_THREADS)
+  {
+    n = MAX_POOL_THREADS;
+  }
+  stopping = 0;
+  for (i = 0; i < n; ++i)
+  {
+    if (pthread_create(&threads[threads_num], NULL, worker, NULL) != 0)
+    {
+      error("Cannot create a worker thread.");
+      break;
+    }
+    ++threads_num;
+  }
+}
+
+void pool_cleanup()
+{
+  int i;
+
+  pthread_mutex_lock(&mutex);
+  while (batches_running != 0)
+  {
+    pthread_cond_wait(&done_cond, &mutex);
+  }
+  stopping = 1;
+  pthread_cond_broadcast(&work_cond);
+  pthread_mutex_unlock(&mutex);
+  for (i = 0; i < threads_num; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  threads_num = 0;
+}
+
+pool_batch_t pool_run(pool_func_t func, void **args, int n)
+{
+  struct Pool_batch *b;
+
+  b = batch_new(func, args, n, NULL, NULL);
+  batch_start(b);
+  return b;
+}
+
+int pool_wait(pool_batch_t b, int timeout)
+{
+  struct timeval now;
+  struct timespec ts;
+  int finished;
+
+  gettimeofday(&now, NULL);
+  ts.tv_sec = now.tv_sec + timeout / 1000;
+  ts.tv_nsec = now.tv_usec * 1000 + (long) (timeout % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000)
+  {
+    ts.tv_sec += 1;
+    ts.tv_nsec -= 1000000000;
+  }
+  pthread_mutex_lock(&mutex);
+  while (b->done != b->n)
+  {
+    if (pthread_cond_timedwait(&done_cond, &mutex, &ts) == ETIMEDOUT)
+    {
+      break;
+    }
+  }
+  finished = b->done == b->n;
+  pthread_mutex_unlock(&mutex);
+  if (finished)
+  {
+    free(b);
+  }
+  return finished;
+}
+
+void pool_run_async(pool_func_t func, void **args, int n,
+                    pool_func_t done, void *done_arg)
+{
+  struct Pool_batch *b;
+
+  b = batch_new(func, args, n, done, done_arg);
+  if (batch_start(b))
+  {
+    done(done_arg);
+    free(b);
+  }
+}
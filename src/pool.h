@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  A pool of worker threads. A batch of jobs is handed to the pool with
+  pool_run, and the caller then waits for it with pool_wait, which lets
+  the caller keep its user interface responsive in the meantime.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+typedef void (*pool_func_t)(void *arg);
+
+typedef struct Pool_batch *pool_batch_t;
+
+/* Starts threads worker threads. If threads is not positive then the
+   number of processors is used. */
+void pool_init(int threads);
+/* Waits for the current batch and stops the worker threads. */
+void pool_cleanup();
+
+/* Runs func(args[i]) for 0 <= i < n on the worker threads, in an
+   unspecified order. Returns at once. The batches are started in the
+   order they are run, and several of them may be running at a time. If
+   the pool has no threads then the jobs are run by the calling thread
+   before returning. */
+pool_batch_t pool_run(pool_func_t func, void **args, int n);
+/* Waits at most timeout milliseconds for the batch to finish. Returns
+   nonzero if it has finished, in which case the batch is freed. */
+int pool_wait(pool_batch_t batch, int timeout);
+/* Like pool_run, but the batch is not waited for. Instead, done(done_arg)
+   is called by the thread that finishes the last job (or by the calling
+   thread if there are no jobs), and the batch is freed by the pool. */
+void pool_run_async(pool_func_t func, void **args, int n,
+                    pool_func_t done, void *done_arg);
+
+#endif
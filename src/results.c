@@ -0,0 +1,313 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "file.h"
+#include "dictionary.h"
+#include "results.h"
+
+#define RESULTS_INITIAL_CAPACITY 16
+#define RESULTS_ARENA_BLOCK_SIZE 8192
+
+typedef int (*cmp_t)(const void *, const void *);
+
+typedef struct{
+  results_t *res;
+  int i; /* the next result of res to be merged */
+} cursor_t;
+
+static void result_read(results_t *res, result_t *r);
+static int line_cmp(const result_t *r1, const result_t *r2);
+static int cursor_cmp(const cursor_t *c1, const cursor_t *c2,
+                      result_cmp_t cmp);
+static void cursor_sift_down(cursor_t *heap, int size, int i,
+                             result_cmp_t cmp);
+
+/************************************************************************/
+
+static void result_read(results_t *res, result_t *r)
+{
+  dict_t *dict = r->dict;
+  int i;
+
+  assert (dict != NULL);
+  file_read_line(dict->file, r->line_idx, 1);
+  assert (file_entries_read == dict->entries_num);
+  r->fields = (char **) arena_alloc(res->arena,
+                                    sizeof(char *) * dict->entries_num);
+  for (i = 0; i < dict->entries_num; ++i)
+  {
+    r->fields[i] = arena_strdup(res->arena,
+                                file_entry[dict->entry_order[i]].str);
+  }
+}
+
+static int line_cmp(const result_t *r1, const result_t *r2)
+{
+  if (r1->dict != r2->dict)
+  {
+    return r1->dict < r2->dict ? -1 : 1;
+  }
+  return r1->line_idx - r2->line_idx;
+}
+
+static int cursor_cmp(const cursor_t *c1, const cursor_t *c2,
+                      result_cmp_t cmp)
+{
+  return cmp(&c1->res->items[c1->i], &c2->res->items[c2->i]);
+}
+
+static void cursor_sift_down(cursor_t *heap, int size, int i,
+                             result_cmp_t cmp)
+{
+  cursor_t c;
+  int j;
+
+  c = heap[i];
+  while ((j = 2 * i + 1) < size)
+  {
+    if (j + 1 < size && cursor_cmp(&heap[j + 1], &heap[j], cmp) < 0)
+    {
+      ++j;
+    }
+    if (cursor_cmp(&c, &heap[j], cmp) <= 0)
+    {
+      break;
+    }
+    heap[i] = heap[j];
+    i = j;
+  }
+  heap[i] = c;
+}
+
+results_t *results_new()
+{
+  results_t *res = (results_t *) xmalloc(sizeof(results_t));
+  res->items = NULL;
+  res->num = 0;
+  res->capacity = 0;
+  res->arena = arena_new(RESULTS_ARENA_BLOCK_SIZE);
+  return res;
+}
+
+void results_free(results_t *res)
+{
+  if (res != NULL)
+  {
+    free(res->items);
+    arena_free(res->arena);
+    free(res);
+  }
+}
+
+void results_add(results_t *res, dict_t *dict, int line_idx)
+{
+  if (res->num == res->capacity)
+  {
+    res->capacity = res->capacity == 0 ? RESULTS_INITIAL_CAPACITY :
+      2 * res->capacity;
+    res->items = (result_t *) xrealloc(res->items,
+                                       sizeof(result_t) * res->capacity);
+  }
+  res->items[res->num].dict = dict;
+  res->items[res->num].line_idx = line_idx;
+  res->items[res->num].fields_num = dict->entries_num;
+  res->items[res->num].fields = NULL;
+  ++res->num;
+}
+
+void results_add_lines(results_t *res, dict_t *dict, const list_t *lst)
+{
+  while (lst != NULL)
+  {
+    results_add(res, dict, lst->u.entry_line_idx);
+    lst = lst->next;
+  }
+}
+
+void results_append(results_t *res, results_t *other)
+{
+  if (res->num + other->num > res->capacity)
+  {
+    res->capacity = res->num + other->num;
+    res->items = (result_t *) xrealloc(res->items,
+                                       sizeof(result_t) * res->capacity);
+  }
+  if (other->num != 0)
+  {
+    memcpy(res->items + res->num, other->items,
+           sizeof(result_t) * other->num);
+  }
+  res->num += other->num;
+  arena_adopt(res->arena, other->arena);
+  free(other->items);
+  free(other);
+}
+
+int results_fields_num(const results_t *res, int i)
+{
+  assert (i < res->num);
+  return res->items[i].fields_num;
+}
+
+char **results_fields(results_t *res, int i)
+{
+  assert (i < res->num);
+  if (res->items[i].fields == NULL)
+  {
+    result_read(res, &res->items[i]);
+  }
+  return res->items[i].fields;
+}
+
+void results_materialize(results_t *res)
+{
+  int i;
+  for (i = 0; i < res->num; ++i)
+  {
+    if (res->items[i].fields == NULL)
+    {
+      result_read(res, &res->items[i]);
+    }
+  }
+}
+
+void results_unique_lines(results_t *res)
+{
+  qsort(res->items, res->num, sizeof(result_t), (cmp_t) line_cmp);
+  results_unique(res, line_cmp);
+}
+
+void results_filter(results_t *res, result_pred_t pred)
+{
+  int i, j;
+
+  j = 0;
+  for (i = 0; i < res->num; ++i)
+  {
+    if (!pred(&res->items[i]))
+    {
+      res->items[j++] = res->items[i];
+    }
+  }
+  res->num = j;
+}
+
+void results_sort(results_t *res, result_cmp_t cmp)
+{
+  qsort(res->items, res->num, sizeof(result_t), (cmp_t) cmp);
+}
+
+void results_unique(results_t *res, result_cmp_t cmp)
+{
+  int i, j;
+
+  if (res->num == 0)
+  {
+    return;
+  }
+  j = 1;
+  for (i = 1; i < res->num; ++i)
+  {
+    if (cmp(&res->items[j - 1], &res->items[i]) != 0)
+    {
+      res->items[j++] = res->items[i];
+    }
+  }
+  res->num = j;
+}
+
+results_t *results_merge(results_t **rs, int n, result_cmp_t cmp)
+{
+  cursor_t *heap;
+  results_t *res;
+  int heap_size, num, i;
+
+  if (n == 0)
+  {
+    return NULL;
+  }
+  heap = (cursor_t *) xmalloc(sizeof(cursor_t) * n);
+  heap_size = 0;
+  num = 0;
+  for (i = 0; i < n; ++i)
+  {
+    if (rs[i]->num != 0)
+    {
+      heap[heap_size].res = rs[i];
+      heap[heap_size].i = 0;
+      ++heap_size;
+      num += rs[i]->num;
+    }
+  }
+  for (i = heap_size / 2 - 1; i >= 0; --i)
+  {
+    cursor_sift_down(heap, heap_size, i, cmp);
+  }
+  res = results_new();
+  res->capacity = num;
+  res->items = (result_t *) xmalloc(sizeof(result_t) * (num + 1));
+  while (heap_size > 0)
+  {
+    res->items[res->num++] = heap[0].res->items[heap[0].i];
+    if (++heap[0].i == heap[0].res->num)
+    {
+      heap[0] = heap[--heap_size];
+    }
+    cursor_sift_down(heap, heap_size, 0, cmp);
+  }
+  free(heap);
+  for (i = 0; i < n; ++i)
+  {
+    arena_adopt(res->arena, rs[i]->arena);
+    free(rs[i]->items);
+    free(rs[i]);
+  }
+  return res;
+}
+
+list_t *results_to_list(results_t *res)
+{
+  list_t *lst;
+  list_t *node;
+  list_t *fields;
+  char **f;
+  int i, j, n;
+
+  lst = NULL;
+  for (i = res->num - 1; i >= 0; --i)
+  {
+    f = results_fields(res, i);
+    n = results_fields_num(res, i);
+    fields = NULL;
+    for (j = n - 1; j >= 0; --j)
+    {
+      node = strlist_node_new(f[j]);
+      node->next = fields;
+      fields = node;
+    }
+    node = list_node_new();
+    node->u.lst = fields;
+    node->next = lst;
+    lst = node;
+  }
+  return lst;
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  Result sets of searches. A result set is an array of the lines found,
+  each given by its dictionary and line index. The entries of a line are
+  read from the dictionary file only when they are first needed, and are
+  then kept in an arena owned by the result set, so no result needs any
+  allocation of its own.
+*/
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include "list.h"
+#include "arena.h"
+
+struct Dict_struct;
+
+typedef struct{
+  struct Dict_struct *dict;
+  int line_idx;
+  int fields_num; /* the number of entries of the line */
+  char **fields;
+  /* fields: NULL, or the entries of the line in the order given by
+     dict->entry_order (see dictionary.h); allocated in the arena of the
+     result set */
+} result_t;
+
+typedef struct{
+  result_t *items;
+  int num;
+  int capacity;
+  arena_t *arena; /* holds the fields of the results */
+} results_t;
+
+typedef int (*result_cmp_t)(const result_t *, const result_t *);
+typedef int (*result_pred_t)(const result_t *);
+
+results_t *results_new();
+void results_free(results_t *res);
+void results_add(results_t *res, struct Dict_struct *dict, int line_idx);
+/* Adds the lines of the list of line indices lst (list_t with
+   entry_line_idx being the valid field). */
+void results_add_lines(results_t *res, struct Dict_struct *dict,
+                       const list_t *lst);
+/* Moves all the results of other to the end of res. other is freed. */
+void results_append(results_t *res, results_t *other);
+/* Returns the number of entries of the i-th result. */
+int results_fields_num(const results_t *res, int i);
+/* Returns the entries of the i-th result, reading them from the
+   dictionary file first if needed. */
+char **results_fields(results_t *res, int i);
+/* Reads the entries of all the results. */
+void results_materialize(results_t *res);
+/* Removes all but one of the results for the same line. Does not keep
+   the order of the results. */
+void results_unique_lines(results_t *res);
+/* Removes the results for which pred returns nonzero. */
+void results_filter(results_t *res, result_pred_t pred);
+/* Sorts the results by cmp, which may use their fields. */
+void results_sort(results_t *res, result_cmp_t cmp);
+/* Removes the results equal (by cmp) to the ones just before them. */
+void results_unique(results_t *res, result_cmp_t cmp);
+/* Merges n result sets sorted by cmp into one. The result sets are
+   consumed. Returns NULL if n is 0. */
+results_t *results_merge(results_t **rs, int n, result_cmp_t cmp);
+/* Returns the results as a list of lists of dynamically allocated
+   strings, which should be freed with list_free_2(list,
+   node_strlist_free). */
+list_t *results_to_list(results_t *res);
+
+#endif
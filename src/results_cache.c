@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "options.h"
+#include "results_cache.h"
+
+typedef struct{
+  struct Dict_struct *dict;
+  int line_idx;
+} cached_line_t;
+
+typedef struct Cache_entry{
+  char *key;
+  cached_line_t *lines;
+  int num;
+  size_t size; /* of the entry together with its key and lines */
+  struct Cache_entry *prev;
+  struct Cache_entry *next;
+} cache_entry_t;
+
+/* The entries, the most recently used first. */
+static cache_entry_t *first_entry = NULL;
+static cache_entry_t *last_entry = NULL;
+static int entries_num = 0;
+static size_t cache_size = 0;
+
+/* Returns the entry for key, or NULL. */
+static cache_entry_t *find_entry(const char *key);
+static void unlink_entry(cache_entry_t *entry);
+static void link_entry_first(cache_entry_t *entry);
+static void free_entry(cache_entry_t *entry);
+
+/************************************************************************/
+
+static cache_entry_t *find_entry(const char *key)
+{
+  cache_entry_t *entry;
+
+  for (entry = first_entry; entry != NULL; entry = entry->next)
+  {
+    if (strcmp(entry->key, key) == 0)
+    {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static void unlink_entry(cache_entry_t *entry)
+{
+  if (entry->prev != NULL)
+  {
+    entry->prev->next = entry->next;
+  }
+  else
+  {
+    first_entry = entry->next;
+  }
+  if (entry->next != NULL)
+  {
+    entry->next->prev = entry->prev;
+  }
+  else
+  {
+    last_entry = entry->prev;
+  }
+  --entries_num;
+  cache_size -= entry->size;
+}
+
+static void link_entry_first(cache_entry_t *entry)
+{
+  entry->prev = NULL;
+  entry->next = first_entry;
+  if (first_entry != NULL)
+  {
+    first_entry->prev = entry;
+  }
+  else
+  {
+    last_entry = entry;
+  }
+  first_entry = entry;
+  ++entries_num;
+  cache_size += entry->size;
+}
+
+static void free_entry(cache_entry_t *entry)
+{
+  free(entry->key);
+  free(entry->lines);
+  free(entry);
+}
+
+results_t *results_cache_get(const char *key)
+{
+  cache_entry_t *entry;
+  results_t *res;
+  int i;
+
+  entry = find_entry(key);
+  if (entry == NULL)
+  {
+    return NULL;
+  }
+  unlink_entry(entry);
+  link_entry_first(entry);
+  res = results_new();
+  for (i = 0; i < entry->num; ++i)
+  {
+    results_add(res, entry->lines[i].dict, entry->lines[i].line_idx);
+  }
+  return res;
+}
+
+void results_cache_put(const char *key, const results_t *res)
+{
+  cache_entry_t *entry;
+  size_t size, max_size;
+  int i;
+
+  assert (key != NULL);
+  assert (res != NULL);
+
+  entry = find_entry(key);
+  if (entry != NULL)
+  {
+    unlink_entry(entry);
+    free_entry(entry);
+  }
+  size = sizeof(cache_entry_t) + strlen(key) + 1 +
+      sizeof(cached_line_t) * res->num;
+  max_size = (size_t) opt_results_cache_size * 1024;
+  if (size > max_size)
+  {
+    return;
+  }
+  while (cache_size + size > max_size)
+  {
+    entry = last_entry;
+    unlink_entry(entry);
+    free_entry(entry);
+  }
+  entry = (cache_entry_t *) xmalloc(sizeof(cache_entry_t));
+  entry->key = xstrdup(key);
+  entry->num = res->num;
+  entry->lines = (cached_line_t *) xmalloc(sizeof(cached_line_t) *
+                                           (res->num + 1));
+  for (i = 0; i < res->num; ++i)
+  {
+    entry->lines[i].dict = res->items[i].dict;
+    entry->lines[i].line_idx = res->items[i].line_idx;
+  }
+  entry->size = size;
+  link_entry_first(entry);
+}
+
+void results_cache_clear()
+{
+  cache_entry_t *entry;
+
+  while (first_entry != NULL)
+  {
+    entry = first_entry;
+    unlink_entry(entry);
+    free_entry(entry);
+  }
+  assert (entries_num == 0);
+  assert (cache_size == 0);
+}
+
+void results_cache_stats(int *entries, size_t *size)
+{
+  *entries = entries_num;
+  *size = cache_size;
+}
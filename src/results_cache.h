@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  A cache of the results of recent searches, so that going back to a
+  search shows its results at once. A search is identified by a key
+  string, which should describe everything its results depend on. Only
+  the dictionary and the line index of each result are stored, so a
+  result takes two words; the entries are read from the file again when
+  shown. The cache holds at most opt_results_cache_size kilobytes, and the
+  least recently used searches are dropped first. It should be used by
+  one thread only.
+*/
+
+#ifndef RESULTS_CACHE_H
+#define RESULTS_CACHE_H
+
+#include "results.h"
+
+/* Returns a new result set with the results cached for key, or NULL if
+   there are none. */
+results_t *results_cache_get(const char *key);
+/* Stores a copy of the results of res for key, replacing the ones
+   stored before. */
+void results_cache_put(const char *key, const results_t *res);
+/* Drops all the results; should be called before a dictionary is
+   freed. */
+void results_cache_clear();
+/* Returns the number of searches cached and the number of bytes they
+   take. */
+void results_cache_stats(int *entries, size_t *size);
+
+#endif
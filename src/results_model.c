@@ -0,0 +1,306 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "file.h"
+#include "results_model.h"
+
+static void results_model_tree_model_init(GtkTreeModelIface *iface);
+static void results_model_finalize(GObject *object);
+static GtkTreeModelFlags results_model_get_flags(GtkTreeModel *tree_model);
+static gint results_model_get_n_columns(GtkTreeModel *tree_model);
+static GType results_model_get_column_type(GtkTreeModel *tree_model,
+                                           gint index);
+static gboolean results_model_get_iter(GtkTreeModel *tree_model,
+                                       GtkTreeIter *iter, GtkTreePath *path);
+static GtkTreePath *results_model_get_path(GtkTreeModel *tree_model,
+                                           GtkTreeIter *iter);
+/* Sets value to the entry in the given column of the row of iter,
+   reading it from the file if needed. */
+static void results_model_get_value(GtkTreeModel *tree_model,
+                                    GtkTreeIter *iter, gint column,
+                                    GValue *value);
+static gboolean results_model_iter_next(GtkTreeModel *tree_model,
+                                        GtkTreeIter *iter);
+static gboolean results_model_iter_children(GtkTreeModel *tree_model,
+                                            GtkTreeIter *iter,
+                                            GtkTreeIter *parent);
+static gboolean results_model_iter_has_child(GtkTreeModel *tree_model,
+                                             GtkTreeIter *iter);
+static gint results_model_iter_n_children(GtkTreeModel *tree_model,
+                                          GtkTreeIter *iter);
+static gboolean results_model_iter_nth_child(GtkTreeModel *tree_model,
+                                             GtkTreeIter *iter,
+                                             GtkTreeIter *parent, gint n);
+static gboolean results_model_iter_parent(GtkTreeModel *tree_model,
+                                          GtkTreeIter *iter,
+                                          GtkTreeIter *child);
+
+G_DEFINE_TYPE_WITH_CODE(ResultsModel, results_model, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,
+                                              results_model_tree_model_init))
+
+/************************************************************************/
+
+static void results_model_class_init(ResultsModelClass *klass)
+{
+  G_OBJECT_CLASS(klass)->finalize = results_model_finalize;
+}
+
+static void results_model_tree_model_init(GtkTreeModelIface *iface)
+{
+  iface->get_flags = results_model_get_flags;
+  iface->get_n_columns = results_model_get_n_columns;
+  iface->get_column_type = results_model_get_column_type;
+  iface->get_iter = results_model_get_iter;
+  iface->get_path = results_model_get_path;
+  iface->get_value = results_model_get_value;
+  iface->iter_next = results_model_iter_next;
+  iface->iter_children = results_model_iter_children;
+  iface->iter_has_child = results_model_iter_has_child;
+  iface->iter_n_children = results_model_iter_n_children;
+  iface->iter_nth_child = results_model_iter_nth_child;
+  iface->iter_parent = results_model_iter_parent;
+}
+
+static void results_model_init(ResultsModel *model)
+{
+  model->stamp = g_random_int();
+  model->columns = 0;
+  model->rows = 0;
+  model->res = NULL;
+  model->file = NULL;
+  model->lines = NULL;
+}
+
+static void results_model_finalize(GObject *object)
+{
+  ResultsModel *model = RESULTS_MODEL(object);
+
+  results_free(model->res);
+  free(model->lines);
+  if (model->file != NULL && --model->file->ref == 0)
+  {
+    file_unload(model->file);
+  }
+  G_OBJECT_CLASS(results_model_parent_class)->finalize(object);
+}
+
+static GtkTreeModelFlags results_model_get_flags(GtkTreeModel *tree_model)
+{
+  return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint results_model_get_n_columns(GtkTreeModel *tree_model)
+{
+  return RESULTS_MODEL(tree_model)->columns;
+}
+
+static GType results_model_get_column_type(GtkTreeModel *tree_model,
+                                           gint index)
+{
+  return G_TYPE_STRING;
+}
+
+static gboolean results_model_get_iter(GtkTreeModel *tree_model,
+                                       GtkTreeIter *iter, GtkTreePath *path)
+{
+  ResultsModel *model = RESULTS_MODEL(tree_model);
+  gint row;
+
+  assert (gtk_tree_path_get_depth(path) == 1);
+  row = gtk_tree_path_get_indices(path)[0];
+  if (row < 0 || row >= model->rows)
+  {
+    return FALSE;
+  }
+  iter->stamp = model->stamp;
+  iter->user_data = GINT_TO_POINTER(row);
+  return TRUE;
+}
+
+static GtkTreePath *results_model_get_path(GtkTreeModel *tree_model,
+                                           GtkTreeIter *iter)
+{
+  GtkTreePath *path;
+
+  assert (iter->stamp == RESULTS_MODEL(tree_model)->stamp);
+  path = gtk_tree_path_new();
+  gtk_tree_path_append_index(path, GPOINTER_TO_INT(iter->user_data));
+  return path;
+}
+
+static void results_model_get_value(GtkTreeModel *tree_model,
+                                    GtkTreeIter *iter, gint column,
+                                    GValue *value)
+{
+  ResultsModel *model = RESULTS_MODEL(tree_model);
+  const gchar *end;
+  const char *s;
+  gint row;
+  int k;
+
+  assert (iter->stamp == model->stamp);
+  assert (column < model->columns);
+  row = GPOINTER_TO_INT(iter->user_data);
+  g_value_init(value, G_TYPE_STRING);
+  if (model->res != NULL)
+  {
+    if (column < results_fields_num(model->res, row))
+    {
+      g_value_set_string(value, results_fields(model->res, row)[column]);
+    }
+  }
+  else
+  {
+    file_read_line(model->file, model->lines[row], 1);
+    k = model->entry_order[column];
+    if (k < file_entries_read)
+    {
+      s = file_entry[k].str;
+      if (g_utf8_validate(s, -1, &end))
+      {
+        g_value_set_string(value, s);
+      }
+      else
+      { /* show the valid part */
+        g_value_take_string(value, g_strndup(s, end - s));
+      }
+    }
+  }
+}
+
+static gboolean results_model_iter_next(GtkTreeModel *tree_model,
+                                        GtkTreeIter *iter)
+{
+  ResultsModel *model = RESULTS_MODEL(tree_model);
+  gint row;
+
+  row = GPOINTER_TO_INT(iter->user_data) + 1;
+  if (row >= model->rows)
+  {
+    return FALSE;
+  }
+  iter->user_data = GINT_TO_POINTER(row);
+  return TRUE;
+}
+
+static gboolean results_model_iter_children(GtkTreeModel *tree_model,
+                                            GtkTreeIter *iter,
+                                            GtkTreeIter *parent)
+{
+  return results_model_iter_nth_child(tree_model, iter, parent, 0);
+}
+
+static gboolean results_model_iter_has_child(GtkTreeModel *tree_model,
+                                             GtkTreeIter *iter)
+{
+  return FALSE;
+}
+
+static gint results_model_iter_n_children(GtkTreeModel *tree_model,
+                                          GtkTreeIter *iter)
+{
+  return iter == NULL ? RESULTS_MODEL(tree_model)->rows : 0;
+}
+
+static gboolean results_model_iter_nth_child(GtkTreeModel *tree_model,
+                                             GtkTreeIter *iter,
+                                             GtkTreeIter *parent, gint n)
+{
+  ResultsModel *model = RESULTS_MODEL(tree_model);
+
+  if (parent != NULL || n < 0 || n >= model->rows)
+  {
+    return FALSE;
+  }
+  iter->stamp = model->stamp;
+  iter->user_data = GINT_TO_POINTER(n);
+  return TRUE;
+}
+
+static gboolean results_model_iter_parent(GtkTreeModel *tree_model,
+                                          GtkTreeIter *iter,
+                                          GtkTreeIter *child)
+{
+  return FALSE;
+}
+
+GtkTreeModel *results_model_new(results_t *res, int columns)
+{
+  ResultsModel *model;
+
+  model = (ResultsModel *) g_object_new(TYPE_RESULTS_MODEL, NULL);
+  model->columns = columns;
+  model->rows = res->num;
+  model->res = res;
+  return GTK_TREE_MODEL(model);
+}
+
+void results_model_append(GtkTreeModel *tree_model, results_t *res)
+{
+  ResultsModel *model = RESULTS_MODEL(tree_model);
+  GtkTreePath *path;
+  GtkTreeIter iter;
+
+  assert (model->res != NULL);
+
+  results_append(model->res, res);
+  iter.stamp = model->stamp;
+  while (model->rows < model->res->num)
+  {
+    iter.user_data = GINT_TO_POINTER(model->rows);
+    ++model->rows;
+    path = gtk_tree_path_new();
+    gtk_tree_path_append_index(path, model->rows - 1);
+    gtk_tree_model_row_inserted(tree_model, path, &iter);
+    gtk_tree_path_free(path);
+  }
+}
+
+GtkTreeModel *results_model_new_dict(dict_t *dict)
+{
+  ResultsModel *model;
+  file_t *file = dict->file;
+  int capacity, i;
+
+  model = (ResultsModel *) g_object_new(TYPE_RESULTS_MODEL, NULL);
+  model->columns = dict->entries_num;
+  memcpy(model->entry_order, dict->entry_order,
+         sizeof(int) * MAX_DICT_ENTRIES);
+  model->file = file;
+  ++file->ref;
+  /* only the offsets of the lines are kept */
+  capacity = dict->size + 1;
+  model->lines = (int *) xmalloc(sizeof(int) * capacity);
+  i = file_read_header(file);
+  while (i < file->length && i != -1)
+  {
+    if (model->rows == capacity)
+    {
+      capacity *= 2;
+      model->lines = (int *) xrealloc(model->lines, sizeof(int) * capacity);
+    }
+    model->lines[model->rows++] = i;
+    i = file_skip_line(file, i);
+  }
+  return GTK_TREE_MODEL(model);
+}
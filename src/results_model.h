@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  A GtkTreeModel showing search results or a whole dictionary. Nothing is
+  copied into GTK in advance: the entries of a row are looked up (and for
+  a dictionary read from the file) only when the view asks for them, so
+  the view should be in the fixed height mode, where it asks only for the
+  visible rows.
+*/
+
+#ifndef RESULTS_MODEL_H
+#define RESULTS_MODEL_H
+
+#include <gtk/gtk.h>
+#include "results.h"
+#include "dictionary.h"
+
+#define TYPE_RESULTS_MODEL (results_model_get_type())
+#define RESULTS_MODEL(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+                            TYPE_RESULTS_MODEL, ResultsModel))
+#define IS_RESULTS_MODEL(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+                               TYPE_RESULTS_MODEL))
+
+typedef struct{
+  GObject parent;
+  gint stamp;
+  int columns;
+  int rows;
+  results_t *res;
+  /* res: the results shown, or NULL if a whole dictionary is shown */
+  file_t *file;
+  int *lines;
+  int entry_order[MAX_DICT_ENTRIES];
+  /* file, lines, entry_order: the file of the dictionary shown, the
+     indices of its lines and the order of their entries (see dict_t) */
+} ResultsModel;
+
+typedef struct{
+  GObjectClass parent_class;
+} ResultsModelClass;
+
+GType results_model_get_type();
+/* Creates a model with the given number of columns showing res, which
+   should be sorted with sort_results. The model takes over res. */
+GtkTreeModel *results_model_new(results_t *res, int columns);
+/* Adds the rows of res after those of a model created with
+   results_model_new, so that the results of a search may be shown while
+   they are still being found. The model takes over res. */
+void results_model_append(GtkTreeModel *tree_model, results_t *res);
+/* Creates a model showing all the lines of dict. The model keeps the
+   file of dict loaded, so it stays valid even if dict is freed. */
+GtkTreeModel *results_model_new_dict(dict_t *dict);
+
+#endif
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "wforms.h"
+#include "stats.h"
+
+THREAD_LOCAL unsigned long stats_counts[STATS_COUNTERS_NUM];
+THREAD_LOCAL unsigned long long stats_ns[STATS_TIMERS_NUM];
+
+static unsigned long total_counts[STATS_COUNTERS_NUM];
+static unsigned long long total_ns[STATS_TIMERS_NUM];
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *counter_names[STATS_COUNTERS_NUM] = {
+  "searches", "variants", "bloom_rejected", "probes", "hits", "postings",
+  "lines_read", "lines_converted", "regex_tests", "comparisons"
+};
+static const char *timer_names[STATS_TIMERS_NUM] = {
+  "wforms", "lookup", "regex", "read", "sort", "display"
+};
+
+unsigned long long stats_clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void stats_flush()
+{
+  int i;
+
+  pthread_mutex_lock(&stats_mutex);
+  for (i = 0; i < STATS_COUNTERS_NUM; ++i)
+  {
+    total_counts[i] += stats_counts[i];
+  }
+  for (i = 0; i < STATS_TIMERS_NUM; ++i)
+  {
+    total_ns[i] += stats_ns[i];
+  }
+  pthread_mutex_unlock(&stats_mutex);
+  memset(stats_counts, 0, sizeof(stats_counts));
+  memset(stats_ns, 0, sizeof(stats_ns));
+}
+
+void stats_get(unsigned long *counts, unsigned long long *ns)
+{
+  pthread_mutex_lock(&stats_mutex);
+  if (counts != NULL)
+  {
+    memcpy(counts, total_counts, sizeof(total_counts));
+  }
+  if (ns != NULL)
+  {
+    memcpy(ns, total_ns, sizeof(total_ns));
+  }
+  pthread_mutex_unlock(&stats_mutex);
+}
+
+void stats_reset()
+{
+  pthread_mutex_lock(&stats_mutex);
+  memset(total_counts, 0, sizeof(total_counts));
+  memset(total_ns, 0, sizeof(total_ns));
+  pthread_mutex_unlock(&stats_mutex);
+  memset(stats_counts, 0, sizeof(stats_counts));
+  memset(stats_ns, 0, sizeof(stats_ns));
+}
+
+const char *stats_counter_name(stats_counter_t c)
+{
+  return counter_names[c];
+}
+
+const char *stats_timer_name(stats_timer_t t)
+{
+  return timer_names[t];
+}
+
+void stats_format(char *buf, int size)
+{
+  unsigned long counts[STATS_COUNTERS_NUM];
+  unsigned long long ns[STATS_TIMERS_NUM];
+  unsigned long hits, misses;
+  int i, len;
+
+  stats_get(counts, ns);
+  wforms_cache_stats(&hits, &misses);
+  len = 0;
+  buf[0] = '\0';
+  for (i = 0; i < STATS_COUNTERS_NUM && len < size; ++i)
+  {
+    len += snprintf(buf + len, size - len, "%s: %lu\n", counter_names[i],
+                    counts[i]);
+  }
+  for (i = 0; i < STATS_TIMERS_NUM && len < size; ++i)
+  {
+    len += snprintf(buf + len, size - len, "%s: %.3f ms\n", timer_names[i],
+                    ns[i] / 1e6);
+  }
+  if (len < size)
+  {
+    snprintf(buf + len, size - len, "wforms_cache: %lu hits, %lu misses\n",
+             hits, misses);
+  }
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  Counters and timers of the work done by searches, which show where the
+  time of a slow search goes. They are always compiled in and cheap: the
+  hot paths only add to per thread counters, which are added to the
+  totals of the process by stats_flush, called at the end of each search
+  and each sort.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "utils.h"
+
+typedef enum{
+  STAT_SEARCHES, /* dictionary searches */
+  STAT_VARIANTS, /* keyword variants (case, umlaut, word forms) generated */
+  STAT_BLOOM_REJECTED, /* variants skipped as not in the Bloom filter */
+  STAT_PROBES, /* hashtable lookups */
+  STAT_HITS, /* hashtable lookups which found the key */
+  STAT_POSTINGS, /* line indices read from the hashtable lists */
+  STAT_LINES_READ, /* lines parsed from the dictionary files */
+  STAT_LINES_CONVERTED, /* lines converted from ISO-8859-15 to UTF-8 */
+  STAT_REGEX_TESTS, /* entries matched against a regex */
+  STAT_COMPARISONS, /* comparisons of results while sorting */
+  STATS_COUNTERS_NUM
+} stats_counter_t;
+
+typedef enum{
+  TIMER_WFORMS, /* generating word forms (the WFA) */
+  TIMER_LOOKUP, /* hashtable lookups of keyword and exact searches */
+  TIMER_REGEX, /* regex searches */
+  TIMER_READ, /* reading and converting the lines of the results */
+  TIMER_SORT, /* sorting, merging and removing duplicate results */
+  TIMER_DISPLAY, /* filling the views of the graphical interface */
+  STATS_TIMERS_NUM
+} stats_timer_t;
+
+/* The size of a buffer large enough for stats_format. */
+#define STATS_TEXT_SIZE 1024
+
+/* per thread; added to the totals by stats_flush */
+extern THREAD_LOCAL unsigned long stats_counts[STATS_COUNTERS_NUM];
+extern THREAD_LOCAL unsigned long long stats_ns[STATS_TIMERS_NUM];
+
+#define STATS_INC(c) (++stats_counts[c])
+#define STATS_ADD(c, n) (stats_counts[c] += (n))
+/* Adds the time since start (a value of stats_clock) to the timer t. */
+#define STATS_TIME(t, start) (stats_ns[t] += stats_clock() - (start))
+
+/* Returns the monotonic time in nanoseconds. */
+unsigned long long stats_clock();
+/* Adds the counters and timers of the calling thread to the totals and
+   zeroes them. */
+void stats_flush();
+/* Reads the totals; either array may be NULL. */
+void stats_get(unsigned long *counts, unsigned long long *ns);
+void stats_reset();
+const char *stats_counter_name(stats_counter_t c);
+const char *stats_timer_name(stats_timer_t t);
+/* Writes the totals, followed by the hits and misses of the word forms
+   cache, to buf (of size size) as lines "name: value". */
+void stats_format(char *buf, int size);
+
+#endif
@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "strhash.h"
+
+static const unsigned long long wyp[4] = {
+  0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/* Computes the 128-bit product of *a and *b, storing the low half in *a
+   and the high half in *b. */
+static inline void wymum(unsigned long long *a, unsigned long long *b)
+{
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 r = *a;
+  r *= *b;
+  *a = (unsigned long long) r;
+  *b = (unsigned long long) (r >> 64);
+#else
+  unsigned long long ha = *a >> 32, hb = *b >> 32;
+  unsigned long long la = (unsigned) *a, lb = (unsigned) *b;
+  unsigned long long rh = ha * hb, rm0 = ha * lb, rm1 = hb * la;
+  unsigned long long rl = la * lb;
+  unsigned long long t = rl + (rm0 << 32);
+  unsigned long long c = t < rl;
+  unsigned long long lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline unsigned long long wymix(unsigned long long a,
+                                       unsigned long long b)
+{
+  wymum(&a, &b);
+  return a ^ b;
+}
+
+static inline unsigned long long wyr8(const unsigned char *p)
+{
+  unsigned long long v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static inline unsigned long long wyr4(const unsigned char *p)
+{
+  unsigned v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline unsigned long long wyr3(const unsigned char *p, size_t k)
+{
+  return (((unsigned long long) p[0]) << 16) |
+    (((unsigned long long) p[k >> 1]) << 8) | p[k - 1];
+}
+
+unsigned long long wyhash(const void *key, size_t len,
+                          unsigned long long seed)
+{
+  const unsigned char *p = (const unsigned char *) key;
+  unsigned long long a, b, see1, see2;
+  size_t i;
+
+  seed ^= wymix(seed ^ wyp[0], wyp[1]);
+  if (len <= 16)
+  {
+    if (len >= 4)
+    {
+      a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+      b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+    }
+    else if (len > 0)
+    {
+      a = wyr3(p, len);
+      b = 0;
+    }
+    else
+    {
+      a = b = 0;
+    }
+  }
+  else
+  {
+    i = len;
+    if (i > 48)
+    {
+      see1 = seed;
+      see2 = seed;
+      do{
+        seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+        see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+        see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      }while(i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16)
+    {
+      seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = wyr8(p + i - 16);
+    b = wyr8(p + i - 8);
+  }
+  a ^= wyp[1];
+  b ^= seed;
+  wymum(&a, &b);
+  return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+static unsigned long long seed = 0;
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+
+static void seed_init()
+{
+  FILE *f;
+
+  f = fopen("/dev/urandom", "rb");
+  if (f == NULL || fread(&seed, sizeof(seed), 1, f) != 1)
+  {
+    seed = wymix(time(NULL), getpid());
+  }
+  if (f != NULL)
+  {
+    fclose(f);
+  }
+  if (seed == 0)
+  {
+    seed = wyp[2];
+  }
+}
+
+unsigned long long strhash_seed()
+{
+  /* the tables may be created by several threads at once */
+  pthread_once(&seed_once, seed_init);
+  return seed;
+}
+
+const char *strhash_name(int func)
+{
+  switch(func){
+  case HASH_FNV:
+    return "fnv";
+  case HASH_WYHASH:
+    return "wyhash";
+  default:
+    return "unknown";
+  }
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+ *   Copyright (C) 2007 by Łukasz Czajka   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+  String hash functions for the hashtables. Which function a hashtable uses
+  is chosen when it is built and is stored with it in the cache, together
+  with the seed.
+*/
+
+#ifndef STRHASH_H
+#define STRHASH_H
+
+#include <stddef.h>
+
+/* Hash functions; the values are stored in cache files. */
+#define HASH_FNV 0 /* 32-bit FNV-1, see fnv.h; ignores the seed */
+#define HASH_WYHASH 1 /* 64-bit wyhash, processes 8 bytes at a time */
+#define HASH_FUNCS_NUM 2
+
+/* wyhash (final version 4) by Wang Yi, released into the public domain. */
+unsigned long long wyhash(const void *key, size_t len,
+                          unsigned long long seed);
+/* Returns a random seed, the same for the whole run of the program. */
+unsigned long long strhash_seed();
+/* Returns a short name of a hash function, e.g. "fnv". */
+const char *strhash_name(int func);
+
+#endif
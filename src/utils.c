@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "strutils.h"
 #include "utils.h"
@@ -84,6 +85,7 @@ static int errors_num = 0;
 static int fifo_start = 0;
 static char *errormsg_fifo[MAX_ERRORS];
 static char last_error_msg[MAX_STR_LEN + 1];
+static pthread_mutex_t errors_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void fatal(const char *msg)
 {
@@ -123,6 +125,7 @@ static void errormsg_fifo_push(char *msg)
 
 void error(const char *msg)
 {
+  pthread_mutex_lock(&errors_mutex);
   if (errors_num < MAX_ERRORS)
   {
     errormsg_fifo_push(xstrdup(msg));
@@ -131,6 +134,7 @@ void error(const char *msg)
   {
     fatal_too_many_errors();
   }
+  pthread_mutex_unlock(&errors_mutex);
 }
 
 void syserr(const char *msg)
@@ -138,6 +142,7 @@ void syserr(const char *msg)
   char *str;
   const char *str2;
   int len1;
+  pthread_mutex_lock(&errors_mutex);
   if (errors_num < MAX_ERRORS)
   {
     str2 = strerror(errno);
@@ -154,13 +159,16 @@ void syserr(const char *msg)
   {
     fatal_too_many_errors();
   }
+  pthread_mutex_unlock(&errors_mutex);
 }
 
 const char *error_str()
 {
+  const char *msg;
+  pthread_mutex_lock(&errors_mutex);
   if (errors_num == 0)
   {
-    return NULL;
+    msg = NULL;
   }
   else
   {
@@ -173,14 +181,16 @@ const char *error_str()
       fifo_start = 0;
     }
     --errors_num;
-    return last_error_msg;
+    msg = last_error_msg;
   }
+  pthread_mutex_unlock(&errors_mutex);
+  return msg;
 }
 
 /* Notification */
 
-progress_notifier_t progress_notifier;
-int progress_max;
+THREAD_LOCAL progress_notifier_t progress_notifier;
+THREAD_LOCAL int progress_max;
 
 notifier_t notifier;
 
@@ -30,6 +30,11 @@
 
 #include "limits.h"
 
+/* The storage class of global variables of which each thread has its own
+   copy. The searches in different dictionaries may run in separate
+   threads (see pool.h). */
+#define THREAD_LOCAL __thread
+
 /* Initialization & cleanup */
 
 void utils_init();
@@ -60,6 +65,7 @@ void fatal(const char *msg);
 void error(const char *msg);
 /* The same, but adds a message returned by strerror(errno). */
 void syserr(const char *msg);
+/* error and syserr may be called from any thread. */
 /* Fetches the first error message in the queue. Returns NULL
   if there are currently no error messages in the queue. Removes
   the returned message from the queue. The returned string points
@@ -74,8 +80,9 @@ const char *error_str();
 typedef int (*progress_notifier_t)();
 typedef void (*notifier_t)(const char *event);
 
-extern progress_notifier_t progress_notifier;
-extern int progress_max;
+/* progress_notifier and progress_max are per thread. */
+extern THREAD_LOCAL progress_notifier_t progress_notifier;
+extern THREAD_LOCAL int progress_max;
 /* notifier should be set by the interface. The program logic uses
   this function to notify various events (what's being cached,
   searched, etc.) */
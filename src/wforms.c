@@ -26,17 +26,21 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 #include "limits.h"
 #include "paths.h"
 #include "options.h"
 #include "list.h"
 #include "strutils.h"
 #include "rbtree.h"
+#include "arena.h"
+#include "fnv.h"
 #include "wforms.h"
 
 #define MAX_CCL 2
 #define MAX_GROUPS 256
 #define MAX_RULES 512
+#define WFA_ARENA_BLOCK_SIZE (64 * 1024)
 
 static const int max_phases[2] = { 6 /*de*/, 3 /*en*/ };
 
@@ -45,20 +49,45 @@ static const int max_phases[2] = { 6 /*de*/, 3 /*en*/ };
 //-------------------------------------------------------------------
 
 typedef struct{
-  char *str; /* the word; dynamically allocated */
+  char *str; /* the word; allocated in the arena */
+  int len; /* strlen(str) */
+  unsigned hash; /* the hash of str */
   int ccl; /* conversion chain length */
   unsigned char rules_mask[MAX_GROUPS / 8]; /* This is a bitvector. */
 } word_data_t;
 
 typedef struct Rule{
   int id;
-  char *pattern; /* The pattern to be matched. Dynamically allocated. */
+  int len; /* The number of characters matched by the pattern. */
+  int next; /* The next rule whose pattern ends at the same trie node;
+               -1 if none. */
   char *arg; /* The rule argument - what is inserted into the set.
                 May contain * and <n>, <-n>, where n is a digit.
                 Dynamically allocated. */
   enum { RULE_PREFIX, RULE_SUFFIX, RULE_TOTAL } type;
 } rule_t;
 
+/* A set of characters. Bit c is set iff c belongs to the set. */
+typedef struct{
+  unsigned char bits[32];
+} char_class_t;
+
+/* The rule patterns are compiled into tries whose edges are labeled with
+   character classes. Prefix patterns are inserted as they are, suffix
+   patterns are inserted reversed. */
+typedef struct{
+  int cls; /* the index of the class labeling the edge into this node */
+  int child; /* the first child; -1 if none */
+  int sibling; /* the next sibling; -1 if none */
+  int rule; /* the first rule whose pattern ends here; -1 if none */
+} trie_node_t;
+
+typedef struct{
+  trie_node_t *nodes; /* nodes[0] is the root; dynamically allocated */
+  int size;
+  int capacity;
+} trie_t;
+
 typedef enum { LANG_DE=0, LANG_EN } lang_t;
 typedef enum { GROUP_INFLECT=0, GROUP_STEM, GROUP_FORMS } group_type_t;
 
@@ -72,17 +101,58 @@ typedef enum { GROUP_INFLECT=0, GROUP_STEM, GROUP_FORMS } group_type_t;
 static rule_t rules[MAX_LANGS][MAX_GROUP_TYPES][MAX_RULES];
 static int rules_num[MAX_LANGS][MAX_GROUP_TYPES];
 
+// tries[lang][group_type][RULE_PREFIX] and [RULE_SUFFIX]; the total rules
+// end at the root of the prefix trie
+static trie_t tries[MAX_LANGS][MAX_GROUP_TYPES][2];
+static char_class_t *classes = NULL; // the distinct character classes
+static int classes_num = 0;
+static int classes_capacity = 0;
+
 static int group_id = 1; // the lowest unused rule group id
 
-static rbtree_t *cwords1; // the set of words to which no rules apply in
-  // this and subsequent phases
-static rbtree_t *cwords2; // the set of words to which some rules may be
-  // applied in the current phase
-static rbtree_t *cwords3; // the words added in the current phase
+// The memory used by the current run of the WFA. It is released at once
+// when the run ends.
+static arena_t *arena = NULL;
+// All the words generated in the current run, in the order of phases:
+// the words to which no rules apply anymore, then the words to which
+// some rules may be applied in the current phase, then the words added
+// in the current phase. Allocated in the arena.
+static word_data_t **cwords;
+static int cwords_num;
+static int cwords_capacity;
+// An open addressing hash table containing all the words from cwords.
+// Allocated in the arena.
+static word_data_t **cwords_set;
+static unsigned cwords_set_mask; // the size of the table minus one
 static lang_t clang;
 static group_type_t cgroup_type;
 
 static word_data_t *word_data;
+static unsigned char matched_rules[MAX_RULES / 8]; // a bitvector
+
+// The cache of the results of the WFA. It maps (lang, options, words) to
+// the list of word forms. The least recently used entry is discarded when
+// the cache is full.
+
+typedef struct Cache_entry{
+  char *key; /* see make_cache_key; dynamically allocated */
+  list_t *words; /* the word forms; a list of dynamically allocated strings */
+  struct Cache_entry *prev; /* the more recently used entry */
+  struct Cache_entry *next; /* the less recently used entry */
+} cache_entry_t;
+
+static rbtree_t *cache = NULL; // the entries ordered by keys
+static cache_entry_t *cache_first = NULL; // the most recently used entry
+static cache_entry_t *cache_last = NULL; // the least recently used entry
+static int cache_size = 0;
+static unsigned long cache_hits = 0;
+static unsigned long cache_misses = 0;
+// A hash of the contents of the rules files, see wforms_rules_hash.
+static unsigned rules_hash = FNV1_32A_INIT;
+
+/* The rules are read only after wforms_init, but the state of the
+   algorithm and the cache are not, so wforms_add is serialized. */
+static pthread_mutex_t wforms_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 //-------------------------------------------------------------------
 // Main helper functions.
@@ -91,22 +161,15 @@ static word_data_t *word_data;
 /* Parses a file with rules. */
 static void parse_rules_file(const char *path, lang_t lang,
                              group_type_t group_type);
-/* Applies a rule r to word_str, unconditionally.
-  star is the * part of word_str. cwords, cpref, csuf, word_data,
-  word_str should be set to appropriate values before calling this function.
-  */
+/* Applies a rule r to word_data, unconditionally.
+  star is the * part of the word. The resulting word is added to cwords
+  unless it is already there. */
 static void apply_rule(const word_data_t *word_data, const char *star,
                        rule_t *r);
-/* Converts a list of strings into a red-black tree representing
-  a set of words. */
-static rbtree_t *word_list_to_set(list_t *lst);
-/* Converts a red-black tree containing words into a list of strings. */
-static list_t *set_to_word_list(rbtree_t *set);
-/* Frees a set containing words together with
-   the data stored. */
-static void word_set_free(rbtree_t *set);
 /* Implements the Word Formation Algorithm. */
 static list_t *wfa(list_t *lst, lang_t lang);
+/* The same as wfa, but looks in the cache first. */
+static list_t *cached_wfa(list_t *lst, lang_t lang);
 
 
 //-----------------------------------------------------------------
@@ -119,16 +182,252 @@ static list_t *wfa(list_t *lst, lang_t lang);
 #define CHECK_RULE_MASK(wd, id) \
   ((((wd)->rules_mask[((id) >> 3)] >> ((id) & 7)) & 1) == 0)
 
-static void free_word_data(void *data)
+#define CLASS_ADD(cl, c) \
+  (cl)->bits[(unsigned char) (c) >> 3] |= (1 << ((unsigned char) (c) & 7));
+
+#define CLASS_CONTAINS(cl, c) \
+  (((cl)->bits[(unsigned char) (c) >> 3] >> ((unsigned char) (c) & 7)) & 1)
+
+static int cmp_word_data(const void *x1, const void *x2)
+{
+  return strcmp((*(word_data_t **) x1)->str, (*(word_data_t **) x2)->str);
+}
+
+static unsigned word_hash(const char *str, int len)
 {
-  word_data_t *wd = (word_data_t *) data;
-  free(wd->str);
-  free(wd);
+  return (unsigned) fnv_32a_buf((void *) str, len, FNV1_32A_INIT);
 }
 
-static int cmp_word_data(void *x1, void *x2)
+static void cwords_set_insert(word_data_t *wd)
 {
-  return strcmp(((word_data_t *) x1)->str, ((word_data_t *) x2)->str);
+  unsigned j = wd->hash & cwords_set_mask;
+  while (cwords_set[j] != NULL)
+  {
+    j = (j + 1) & cwords_set_mask;
+  }
+  cwords_set[j] = wd;
+}
+
+static void cwords_set_rebuild(unsigned size)
+{
+  int i;
+  cwords_set = (word_data_t **) arena_alloc(arena,
+                                            size * sizeof(word_data_t *));
+  bzero(cwords_set, size * sizeof(word_data_t *));
+  cwords_set_mask = size - 1;
+  for (i = 0; i < cwords_num; ++i)
+  {
+    cwords_set_insert(cwords[i]);
+  }
+}
+
+// Returns the word from cwords equal to str, or NULL if there is none.
+static word_data_t *cwords_find(const char *str, int len, unsigned hash)
+{
+  word_data_t *wd;
+  unsigned j = hash & cwords_set_mask;
+  while ((wd = cwords_set[j]) != NULL)
+  {
+    if (wd->hash == hash && wd->len == len && memcmp(wd->str, str, len) == 0)
+    {
+      return wd;
+    }
+    j = (j + 1) & cwords_set_mask;
+  }
+  return NULL;
+}
+
+// Adds a word which is not yet present to cwords.
+static word_data_t *cwords_add(const char *str, int len, unsigned hash,
+                               int ccl)
+{
+  word_data_t **v;
+  word_data_t *wd = (word_data_t *) arena_alloc(arena, sizeof(word_data_t));
+  wd->str = arena_strndup(arena, str, len);
+  wd->len = len;
+  wd->hash = hash;
+  wd->ccl = ccl;
+  bzero(wd->rules_mask, sizeof(wd->rules_mask));
+  if (cwords_num == cwords_capacity)
+  {
+    v = (word_data_t **) arena_alloc(arena, 2 * cwords_capacity *
+                                     sizeof(word_data_t *));
+    memcpy(v, cwords, cwords_num * sizeof(word_data_t *));
+    cwords = v;
+    cwords_capacity *= 2;
+  }
+  cwords[cwords_num++] = wd;
+  if (2 * cwords_num > cwords_set_mask + 1)
+  {
+    cwords_set_rebuild(2 * (cwords_set_mask + 1));
+  }
+  else
+  {
+    cwords_set_insert(wd);
+  }
+  return wd;
+}
+
+// Returns the index of cl in classes, adding it if necessary.
+static int add_class(const char_class_t *cl)
+{
+  int i;
+  for (i = 0; i < classes_num; ++i)
+  {
+    if (memcmp(&classes[i], cl, sizeof(char_class_t)) == 0)
+    {
+      return i;
+    }
+  }
+  if (classes_num == classes_capacity)
+  {
+    classes_capacity = classes_capacity == 0 ? 16 : classes_capacity * 2;
+    classes = (char_class_t *) xrealloc(classes,
+                                        classes_capacity *
+                                        sizeof(char_class_t));
+  }
+  classes[classes_num] = *cl;
+  return classes_num++;
+}
+
+// Compiles a pattern into a sequence of character classes stored in cls.
+// Returns the length of the sequence, or -1 if the pattern is malformed.
+// Only ASCII characters ever belong to <c>, <v> and [...], so that UTF-8
+// characters are not split.
+static int compile_pattern(const char *s, int *cls)
+{
+  char_class_t cl;
+  int i, n, c, beg, neg;
+  i = 0;
+  n = 0;
+  while (s[i] != '\0')
+  {
+    bzero(&cl, sizeof(cl));
+    if (s[i] == '<')
+    {
+      if ((s[i + 1] != 'c' && s[i + 1] != 'v') || s[i + 2] != '>')
+      {
+        return -1;
+      }
+      for (c = 0; c < 128; ++c)
+      {
+        if ((s[i + 1] == 'c' && is_en_consonant(c)) ||
+            (s[i + 1] == 'v' && is_en_vowel(c)))
+        {
+          CLASS_ADD(&cl, c);
+        }
+      }
+      i += 3;
+    }
+    else if (s[i] == '[')
+    {
+      ++i;
+      neg = 0;
+      if (s[i] == '^')
+      {
+        neg = 1;
+        ++i;
+      }
+      beg = i;
+      while (s[i] != '\0' && s[i] != ']')
+      {
+        ++i;
+      }
+      if (s[i] == '\0')
+      {
+        return -1;
+      }
+      for (c = 1; c < 128; ++c)
+      {
+        if (isalnum(c) && (memchr(s + beg, c, i - beg) == NULL) == neg)
+        {
+          CLASS_ADD(&cl, c);
+        }
+      }
+      ++i;
+    }
+    else
+    {
+      CLASS_ADD(&cl, s[i]);
+      ++i;
+    }
+    cls[n++] = add_class(&cl);
+  }
+  return n;
+}
+
+// Checks the syntax of a rule argument.
+static int check_rule_arg(const char *s)
+{
+  int i, val, s_len;
+  s_len = strlen(s);
+  for (i = 0; i < s_len; ++i)
+  {
+    if (s[i] == '<')
+    {
+      ++i;
+      if (s[i] == '-')
+      {
+        ++i;
+      }
+      val = 0;
+      while (isdigit(s[i]))
+      {
+        val = val * 10 + s[i] - '0';
+        ++i;
+      }
+      if (s[i] != '>' || val < 1 || val > s_len)
+      {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+static int trie_new_node(trie_t *t, int cls)
+{
+  if (t->size == t->capacity)
+  {
+    t->capacity = t->capacity == 0 ? 64 : t->capacity * 2;
+    t->nodes = (trie_node_t *) xrealloc(t->nodes,
+                                        t->capacity * sizeof(trie_node_t));
+  }
+  t->nodes[t->size].cls = cls;
+  t->nodes[t->size].child = -1;
+  t->nodes[t->size].sibling = -1;
+  t->nodes[t->size].rule = -1;
+  return t->size++;
+}
+
+// Returns the node reached from the root by the path labeled with
+// cls[0], ..., cls[n - 1], creating it if necessary.
+static int trie_insert(trie_t *t, const int *cls, int n)
+{
+  int node = 0, i, c;
+  for (i = 0; i < n; ++i)
+  {
+    c = t->nodes[node].child;
+    while (c != -1 && t->nodes[c].cls != cls[i])
+    {
+      c = t->nodes[c].sibling;
+    }
+    if (c == -1)
+    {
+      c = trie_new_node(t, cls[i]);
+      t->nodes[c].sibling = t->nodes[node].child;
+      t->nodes[node].child = c;
+    }
+    node = c;
+  }
+  return node;
+}
+
+static void rules_file_error(const char *path, int line, const char *msg)
+{
+  char str[MAX_STR_LEN * 2];
+  snprintf(str, sizeof(str), "%s:%d: %s", path, line, msg);
+  error(str);
 }
 
 static void parse_rules_file(const char *path, lang_t lang,
@@ -138,8 +437,20 @@ static void parse_rules_file(const char *path, lang_t lang,
   char str[MAX_STR_LEN];
   const char *s;
   char w[MAX_STR_LEN];
-  int s_len, i, size, j;
+  char pattern[MAX_STR_LEN];
+  int cls[MAX_STR_LEN];
+  int s_len, i, size, j, line, node;
   rule_t *r;
+  trie_t *t;
+
+  for (i = 0; i < 2; ++i)
+  {
+    t = &tries[lang][group_type][i];
+    t->nodes = NULL;
+    t->size = 0;
+    t->capacity = 0;
+    trie_new_node(t, -1);
+  }
 
   f = fopen(path, "r");
   if (f == NULL)
@@ -151,8 +462,11 @@ static void parse_rules_file(const char *path, lang_t lang,
   else
   {
     size = 0;
+    line = 0;
     while (fgets(str, MAX_STR_LEN, f) != NULL)
     {
+      ++line;
+      rules_hash = fnv_32a_buf(str, strlen(str), rules_hash);
       s = trim_spaces(str, strlen(str), &s_len);
       if (s_len > 0 && s[0] != '#')
       {
@@ -169,7 +483,7 @@ static void parse_rules_file(const char *path, lang_t lang,
           }
           else
           {
-            fatal("Expected '@@'.");
+            rules_file_error(path, line, "Expected '@@'.");
           }
         }
         else
@@ -179,45 +493,76 @@ static void parse_rules_file(const char *path, lang_t lang,
             fatal("Too many rules.");
           }
           r = &rules[lang][group_type][size];
-          ++size;
           r->id = group_id;
           if (s[0] == '*')
           { // suffix or total
             i = 1;
-            i = read_word(s, s_len, i, w, MAX_STR_LEN);
+            i = read_word(s, s_len, i, pattern, MAX_STR_LEN);
             if (s[i] != '\0' && !isspace(s[i]))
             {
-              fatal("Expected whitespace.");
+              rules_file_error(path, line, "Expected whitespace.");
+              continue;
             }
             if (i == 1)
             { // total
-              r->pattern = NULL;
               r->type = RULE_TOTAL;
             }
             else
             { // suffix
-              r->pattern = xstrdup(w);
               r->type = RULE_SUFFIX;
             }
-            i = skip_ws(s, s_len, i);
-            i = read_word(s, s_len, i, w, MAX_STR_LEN);
-            r->arg = xstrdup(w);
           }
           else
           { // prefix
-            i = read_word(s, s_len, 0, w, MAX_STR_LEN);
-            j = strlen(w) - 1;
-            if (w[j] != '*')
+            i = read_word(s, s_len, 0, pattern, MAX_STR_LEN);
+            j = strlen(pattern) - 1;
+            if (pattern[j] != '*')
             {
-              fatal("Expected '*'.");
+              rules_file_error(path, line, "Expected '*'.");
+              continue;
             }
-            w[j] = '\0';
-            r->pattern = xstrdup(w);
-            i = skip_ws(s, s_len, i);
-            i = read_word(s, s_len, i, w, MAX_STR_LEN);
-            r->arg = xstrdup(w);
+            pattern[j] = '\0';
             r->type = RULE_PREFIX;
           }
+          i = skip_ws(s, s_len, i);
+          i = read_word(s, s_len, i, w, MAX_STR_LEN);
+          if (!check_rule_arg(w))
+          {
+            rules_file_error(path, line, "Malformed rule argument.");
+            continue;
+          }
+          if (r->type == RULE_TOTAL)
+          {
+            r->len = 0;
+          }
+          else
+          {
+            r->len = compile_pattern(pattern, cls);
+            if (r->len < 0)
+            {
+              rules_file_error(path, line, "Malformed rule pattern.");
+              continue;
+            }
+          }
+          if (r->type == RULE_SUFFIX)
+          {
+            for (j = 0; j < r->len / 2; ++j)
+            {
+              i = cls[j];
+              cls[j] = cls[r->len - 1 - j];
+              cls[r->len - 1 - j] = i;
+            }
+            t = &tries[lang][group_type][RULE_SUFFIX];
+          }
+          else
+          {
+            t = &tries[lang][group_type][RULE_PREFIX];
+          }
+          node = trie_insert(t, cls, r->len);
+          r->next = t->nodes[node].rule;
+          t->nodes[node].rule = size;
+          r->arg = xstrdup(w);
+          ++size;
         }
       }
     } // end while (fgets)
@@ -229,13 +574,14 @@ static void parse_rules_file(const char *path, lang_t lang,
 static void apply_rule(const word_data_t *word_data,
                        const char *star, rule_t *r)
 {
-  int i = 0, j = 0;
+  int i = 0, j = 0, ccl, len;
+  unsigned hash;
   char w[MAX_STR_LEN + 1];
   const char *s = r->arg;
   int s_len = strlen(s);
   word_data_t *wd;
   const char *word_str = word_data->str;
-  int word_len = strlen(word_str);
+  int word_len = word_data->len;
   while (i < s_len && j < MAX_STR_LEN)
   {
     if (s[i] == '<')
@@ -292,348 +638,291 @@ static void apply_rule(const word_data_t *word_data,
   {
     w[MAX_STR_LEN] = '\0';
   }
-  wd = (word_data_t *) xmalloc(sizeof(word_data_t));
   if (j > word_len)
   {
-    wd->ccl = word_data->ccl + 1;
+    ccl = word_data->ccl + 1;
   }
   else
   {
-    wd->ccl = word_data->ccl;
-  }
-  bzero(wd->rules_mask, sizeof(wd->rules_mask));
-  SET_RULE_MASK(wd, r->id);
-  wd->str = xstrdup(w);
-  if (wd->ccl <= MAX_CCL && rb_search(cwords1, wd) == NULL &&
-      rb_search(cwords2, wd) == NULL &&
-      rb_search(cwords3, wd) == NULL)
-  {
-    rb_insert(cwords3, wd);
+    ccl = word_data->ccl;
   }
-  else
+  if (ccl <= MAX_CCL)
   {
-    free_word_data(wd);
+    len = strlen(w);
+    hash = word_hash(w, len);
+    if (cwords_find(w, len, hash) == NULL)
+    {
+      wd = cwords_add(w, len, hash, ccl);
+      SET_RULE_MASK(wd, r->id);
+    }
   }
 }
 
-// star must be at least strlen(str) + 1 bytes long.
-static int rule_matches(rule_t *r, const char *str, char *star)
+// Marks in matched_rules the rules from the trie t whose patterns match
+// str, starting with the character at the given depth below node. The
+// characters are taken from the end of str if the trie is a suffix trie.
+// The pattern must leave at least one character of str unmatched.
+static void trie_match(const trie_t *t, int node, const char *str,
+                       int len, int depth, int suffix)
 {
-  int i, j, s_len, len, neg, f;
-  const char *s;
-  assert (r != NULL);
-  assert (str != NULL);
-  assert (star != NULL);
-
-  switch(r->type){
-    case RULE_PREFIX:
-      j = 0; i = 0;
-      s = r->pattern;
-      s_len = strlen(s);
-      len = strlen(str);
-      while (i < s_len && j < len)
-      {
-        switch(s[i]){
-          case '<':
-            if (s_len - i < 3)
-            {
-              fatal("Error in wforms file.");
-            }
-            ++i;
-            if (s[i] == 'c')
-            {
-              if (!is_en_consonant(str[j]))
-              {
-                return 0;
-              }
-              ++j;
-            }
-            else if (s[i] == 'v')
-            {
-              if (!is_en_vowel(str[j]))
-              {
-                return 0;
-              }
-              ++j;
-            }
-            else
-            {
-              fatal("Error in wforms file");
-            }
-            ++i;
-            if (s[i] != '>')
-            {
-              fatal("Error in wforms file.");
-            }
-            ++i;
-            break;
-          case '[':
-            if (!isalnum(str[j]))
-            { // to avoid corrupting UTF-8 characters
-              return 0;
-            }
-            f = 0;
-            ++i;
-            if (s[i] == '^')
-            {
-              neg = 1;
-              ++i;
-            }
-            else
-            {
-              neg = 0;
-            }
-            while (i < s_len && s[i] != ']')
-            {
-              f = f || (s[i] == str[j]);
-              ++i;
-            }
-            if (i == s_len)
-            {
-              fatal("Error in wforms.");
-            }
-            ++i;
-            if ((!neg && !f) || (neg && f))
-            {
-              return 0;
-            }
-            ++j;
-            break;
-          default:
-            if (s[i] != str[j])
-            {
-              return 0;
-            }
-            ++i; ++j;
-            break;
-        };
-      }
-      if (j < len)
-      {
-        strcpy(star, str + j);
-        return 1;
-      }
-      else
-      {
-        return 0;
-      }
-
-    case RULE_SUFFIX:
-      j = strlen(str) - 1;
-      s = r->pattern;
-      i = strlen(s) - 1;
-      while (i >= 0 && j >= 0)
-      {
-        switch(s[i]){
-          case '>':
-            if (i < 2)
-            {
-              fatal("Error in wforms file.");
-            }
-            --i;
-            if (s[i] == 'c')
-            {
-              if (!is_en_consonant(str[j]))
-              {
-                return 0;
-              }
-              --j;
-            }
-            else if (s[i] == 'v')
-            {
-              if (!is_en_vowel(str[j]))
-              {
-                return 0;
-              }
-              --j;
-            }
-            else
-            {
-              fatal("Error in wforms file");
-            }
-            --i;
-            if (s[i] != '<')
-            {
-              fatal("Error in wforms file.");
-            }
-            --i;
-            break;
-          case ']':
-            if (!isalnum(str[j]))
-            { // to avoid corrupting UTF-8 characters
-              return 0;
-            }
-            f = 0;
-            --i;
-            while (i >= 0 && s[i] != '[')
-            {
-              if (i > 0 && s[i] == '^' && s[i - 1] == '[')
-              {
-                f = !f;
-              }
-              else
-              {
-                f = f || (s[i] == str[j]);
-              }
-              --i;
-            }
-            if (i < 0)
-            {
-              fatal("Error in wforms.");
-            }
-            --i;
-            if (!f)
-            {
-              return 0;
-            }
-            --j;
-            break;
-          default:
-            if (s[i] != str[j])
-            {
-              return 0;
-            }
-            --i; --j;
-            break;
-        };
-      }
-      if (j >= 0)
-      {
-        strncpy(star, str, j + 1);
-        star[j + 1] = '\0';
-        return 1;
-      }
-      else
+  const trie_node_t *n;
+  int c, k;
+  char ch;
+  if (depth + 1 >= len)
+  {
+    return;
+  }
+  ch = suffix ? str[len - 1 - depth] : str[depth];
+  for (c = t->nodes[node].child; c != -1; c = n->sibling)
+  {
+    n = &t->nodes[c];
+    if (CLASS_CONTAINS(&classes[n->cls], ch))
+    {
+      for (k = n->rule; k != -1; k = rules[clang][cgroup_type][k].next)
       {
-        return 0;
+        matched_rules[k >> 3] |= 1 << (k & 7);
       }
-
-    case RULE_TOTAL:
-      strcpy(star, str);
-      return 1;
+      trie_match(t, c, str, len, depth + 1, suffix);
+    }
   }
-  return 0;
 }
 
-static void apply_rules_to_word_data(void *data)
+static void apply_rules_to_word_data(word_data_t *data)
 {
-  int i, size;
+  int i, k, size, len, star_len;
   rule_t *r;
+  trie_t *t;
   char star[MAX_STR_LEN];
   size = rules_num[clang][cgroup_type];
-  word_data = (word_data_t *) data;
+  word_data = data;
+  len = word_data->len;
+  bzero(matched_rules, (size + 7) / 8);
+  t = &tries[clang][cgroup_type][RULE_PREFIX];
+  for (k = t->nodes[0].rule; k != -1; k = rules[clang][cgroup_type][k].next)
+  { // total rules
+    matched_rules[k >> 3] |= 1 << (k & 7);
+  }
+  trie_match(t, 0, word_data->str, len, 0, 0);
+  trie_match(&tries[clang][cgroup_type][RULE_SUFFIX], 0, word_data->str,
+             len, 0, 1);
+  // the rules must be applied in the order of their appearance
   for (i = 0; i < size; ++i)
   {
+    if (matched_rules[i >> 3] == 0)
+    {
+      i |= 7;
+      continue;
+    }
     r = &rules[clang][cgroup_type][i];
-    if (CHECK_RULE_MASK(word_data, r->id) &&
-        rule_matches(r, word_data->str, star))
+    if (((matched_rules[i >> 3] >> (i & 7)) & 1) &&
+        CHECK_RULE_MASK(word_data, r->id))
     { // rule not yet applied to this word
       SET_RULE_MASK(word_data, r->id);
-      if (strlen(star) > 2)
+      star_len = len - r->len;
+      if (star_len > 2)
       {
+        if (r->type == RULE_PREFIX)
+        {
+          strcpy(star, word_data->str + r->len);
+        }
+        else
+        {
+          memcpy(star, word_data->str, star_len);
+          star[star_len] = '\0';
+        }
         apply_rule(word_data, star, r);
       }
     }
   }
 }
 
-static rbtree_t *word_list_to_set(list_t *lst)
+static list_t *wfa(list_t *lst, lang_t lang)
 {
-  rbtree_t *set;
+  list_t *lst2, *node;
   char w[MAX_STR_LEN];
   char *s;
-  int s_len;
-  set = rb_new(cmp_word_data);
-  while (lst != NULL)
+  int s_len, phase, beg, end, i;
+  unsigned hash;
+  clang = lang;
+  cwords_num = 0;
+  cwords_capacity = 64;
+  cwords = (word_data_t **) arena_alloc(arena, cwords_capacity *
+                                        sizeof(word_data_t *));
+  cwords_set_rebuild(128);
+  for (node = lst; node != NULL; node = node->next)
   {
-    word_data_t *wd = (word_data_t *) xmalloc(sizeof(word_data_t));
-    xstrncpy(w, lst->u.str, MAX_STR_LEN);
+    xstrncpy(w, node->u.str, MAX_STR_LEN);
     s = (char *) trim_spaces(w, strlen(w), &s_len);
-    s[s_len] = '\0';
-    wd->str = xstrdup(s);
-    wd->ccl = 0;
-    bzero(wd->rules_mask, sizeof(wd->rules_mask));
-    if (rb_search(set, wd) == NULL)
+    hash = word_hash(s, s_len);
+    if (cwords_find(s, s_len, hash) == NULL)
     {
-      rb_insert(set, wd);
+      cwords_add(s, s_len, hash, 0);
     }
-    else
+  }
+  strlist_free(lst);
+  beg = 0;
+  phase = 0;
+  while (beg < cwords_num && phase < max_phases[lang])
+  {
+    end = cwords_num;
+    // The order determines which derivation of a word produced twice in
+    // this phase counts, so it must not depend on the hash table.
+    qsort(cwords + beg, end - beg, sizeof(word_data_t *), cmp_word_data);
+    if (opt_search_inflections)
+    {
+      cgroup_type = GROUP_INFLECT;
+      for (i = beg; i < end; ++i)
+      {
+        apply_rules_to_word_data(cwords[i]);
+      }
+    }
+    if (opt_search_stem)
+    {
+      cgroup_type = GROUP_STEM;
+      for (i = beg; i < end; ++i)
+      {
+        apply_rules_to_word_data(cwords[i]);
+      }
+    }
+    if (opt_search_forms)
     {
-      free(wd);
+      cgroup_type = GROUP_FORMS;
+      for (i = beg; i < end; ++i)
+      {
+        apply_rules_to_word_data(cwords[i]);
+      }
     }
-    lst = lst->next;
+    beg = end;
+    ++phase;
+  }
+  lst2 = NULL;
+  for (i = cwords_num - 1; i >= 0; --i)
+  {
+    node = strlist_node_new(cwords[i]->str);
+    node->next = lst2;
+    lst2 = node;
   }
-  return set;
+#ifdef DEBUG
+  fprintf(stderr, "\nWord Formation Algorithm\n");
+  fprintf(stderr, "phases: %d\n", phase);
+  fprintf(stderr, "words: %d\n", cwords_num);
+  fprintf(stderr, "memory: %lu\n", (unsigned long) arena->allocated);
+#endif
+  arena_reset(arena);
+  return lst2;
 }
 
-static list_t *word_list;
+// Returns a dynamically allocated string identifying the result of the
+// WFA for lst: the language, the options in effect and the words.
+static char *make_cache_key(list_t *lst, lang_t lang)
+{
+  list_t *l;
+  char *key;
+  int len, i;
+
+  len = 3;
+  for (l = lst; l != NULL; l = l->next)
+  {
+    len += strlen(l->u.str) + 1;
+  }
+  key = (char *) xmalloc(len);
+  key[0] = '0' + lang;
+  key[1] = '0' + (opt_search_inflections ? 1 : 0) +
+      (opt_search_stem ? 2 : 0) + (opt_search_forms ? 4 : 0);
+  i = 2;
+  for (l = lst; l != NULL; l = l->next)
+  {
+    len = strlen(l->u.str);
+    memcpy(key + i, l->u.str, len);
+    i += len;
+    key[i++] = '\n';
+  }
+  key[i] = '\0';
+  return key;
+}
 
-static void add_to_word_list(void *data)
+static int cmp_cache_entry(void *x1, void *x2)
 {
-  list_t *node = strlist_node_new(((word_data_t *) data)->str);
-  node->next = word_list;
-  word_list = node;
+  return strcmp(((cache_entry_t *) x1)->key, ((cache_entry_t *) x2)->key);
 }
 
-static list_t *set_to_word_list(rbtree_t *set)
+static void cache_unlink(cache_entry_t *e)
 {
-  word_list = NULL;
-  rb_for_all(set, add_to_word_list);
-  return word_list;
+  if (e->prev != NULL)
+  {
+    e->prev->next = e->next;
+  }
+  else
+  {
+    cache_first = e->next;
+  }
+  if (e->next != NULL)
+  {
+    e->next->prev = e->prev;
+  }
+  else
+  {
+    cache_last = e->prev;
+  }
 }
 
-static void word_set_free(rbtree_t *set)
+static void cache_push_front(cache_entry_t *e)
 {
-  rb_for_all(set, free_word_data);
-  rb_free(set);
+  e->prev = NULL;
+  e->next = cache_first;
+  if (cache_first != NULL)
+  {
+    cache_first->prev = e;
+  }
+  else
+  {
+    cache_last = e;
+  }
+  cache_first = e;
 }
 
-static void add_to_cwords1(void *data)
+static void cache_entry_free(cache_entry_t *e)
 {
-  assert (rb_search(cwords1, data) == 0);
-  rb_insert(cwords1, data);
+  free(e->key);
+  strlist_free(e->words);
+  free(e);
 }
 
-static list_t *wfa(list_t *lst, lang_t lang)
+static list_t *cached_wfa(list_t *lst, lang_t lang)
 {
+  cache_entry_t *e;
+  cache_entry_t x;
+  rbnode_t *node;
   list_t *lst2;
-  int phase = 0;
-  clang = lang;
-  cwords1 = rb_new(cmp_word_data);
-  cwords2 = word_list_to_set(lst);
-  strlist_free(lst);
-  while (!rb_empty(cwords2) && phase < max_phases[lang])
+
+  x.key = make_cache_key(lst, lang);
+  node = rb_search(cache, &x);
+  if (node != NULL)
   {
-    cwords3 = rb_new(cmp_word_data);
-    if (opt_search_inflections)
-    {
-      cgroup_type = GROUP_INFLECT;
-      rb_for_all(cwords2, apply_rules_to_word_data);
-    }
-    if (opt_search_stem)
-    {
-      cgroup_type = GROUP_STEM;
-      rb_for_all(cwords2, apply_rules_to_word_data);
-    }
-    if (opt_search_forms)
-    {
-      cgroup_type = GROUP_FORMS;
-      rb_for_all(cwords2, apply_rules_to_word_data);
-    }
-    rb_for_all(cwords2, add_to_cwords1);
-    rb_free(cwords2);
-    cwords2 = cwords3;
-    ++phase;
+    ++cache_hits;
+    free(x.key);
+    strlist_free(lst);
+    e = (cache_entry_t *) node->key;
+    cache_unlink(e);
+    cache_push_front(e);
+    return strlist_copy(e->words);
+  }
+  ++cache_misses;
+  lst2 = wfa(lst, lang);
+  e = (cache_entry_t *) xmalloc(sizeof(cache_entry_t));
+  e->key = x.key;
+  e->words = strlist_copy(lst2);
+  rb_insert(cache, e);
+  cache_push_front(e);
+  ++cache_size;
+  if (cache_size > MAX_WFORMS_CACHE_SIZE)
+  {
+    e = cache_last;
+    cache_unlink(e);
+    rb_delete(cache, e);
+    cache_entry_free(e);
+    --cache_size;
   }
-  rb_for_all(cwords2, add_to_cwords1);
-  rb_free(cwords2);
-  lst2 = set_to_word_list(cwords1);
-  word_set_free(cwords1);
-#ifdef DEBUG
-  fprintf(stderr, "\nWord Formation Algorithm\n");
-  fprintf(stderr, "phases: %d\n", phase);
-  fprintf(stderr, "words: %d\n", list_length(lst2));
-#endif
   return lst2;
 }
 
@@ -646,17 +935,54 @@ list_t *wforms_add(list_t *lst, const char *lang)
 {
   if (strcmp(lang, "de") == 0)
   {
-    return wfa(lst, LANG_DE);
+    pthread_mutex_lock(&wforms_mutex);
+    lst = cached_wfa(lst, LANG_DE);
+    pthread_mutex_unlock(&wforms_mutex);
   }
   else if (strcmp(lang, "en") == 0)
   {
-    return wfa(lst, LANG_EN);
+    pthread_mutex_lock(&wforms_mutex);
+    lst = cached_wfa(lst, LANG_EN);
+    pthread_mutex_unlock(&wforms_mutex);
   }
   else
   {
     error("Unknown language.");
-    return lst;
   }
+  return lst;
+}
+
+void wforms_cache_clear()
+{
+  cache_entry_t *e;
+  pthread_mutex_lock(&wforms_mutex);
+  while (cache_first != NULL)
+  {
+    e = cache_first;
+    cache_first = e->next;
+    cache_entry_free(e);
+  }
+  cache_last = NULL;
+  cache_size = 0;
+  if (cache != NULL)
+  {
+    rb_free(cache);
+  }
+  cache = rb_new(cmp_cache_entry);
+  pthread_mutex_unlock(&wforms_mutex);
+}
+
+void wforms_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+  pthread_mutex_lock(&wforms_mutex);
+  *hits = cache_hits;
+  *misses = cache_misses;
+  pthread_mutex_unlock(&wforms_mutex);
+}
+
+unsigned wforms_rules_hash()
+{
+  return rules_hash;
 }
 
 void wforms_init()
@@ -665,6 +991,11 @@ void wforms_init()
   int l1 = strlen(path_data_dir);
   strcpy(path, path_data_dir);
 
+  /* the cached results depend on the rules */
+  wforms_cache_clear();
+  rules_hash = FNV1_32A_INIT;
+  arena = arena_new(WFA_ARENA_BLOCK_SIZE);
+
   strcpy(path + l1, "/de.inflect");
   parse_rules_file(path, LANG_DE, GROUP_INFLECT);
 
@@ -687,6 +1018,15 @@ void wforms_init()
 void wforms_cleanup()
 {
   int i, j, k, size;
+#ifdef DEBUG
+  fprintf(stderr, "\nwforms cache hits = %lu\n", cache_hits);
+  fprintf(stderr, "wforms cache misses = %lu\n", cache_misses);
+#endif
+  wforms_cache_clear();
+  rb_free(cache);
+  cache = NULL;
+  arena_free(arena);
+  arena = NULL;
   for (i = 0; i < MAX_LANGS; ++i)
   {
     for (j = 0; j < MAX_GROUP_TYPES; ++j)
@@ -695,13 +1035,15 @@ void wforms_cleanup()
       for (k = 0; k < size; ++k)
       {
         free(rules[i][j][k].arg);
-        if (rules[i][j][k].pattern != NULL)
-        {
-          free(rules[i][j][k].pattern);
-        }
       }
+      free(tries[i][j][RULE_PREFIX].nodes);
+      free(tries[i][j][RULE_SUFFIX].nodes);
     }
   }
+  free(classes);
+  classes = NULL;
+  classes_num = 0;
+  classes_capacity = 0;
 }
 
 void wforms_test()
@@ -795,4 +1137,7 @@ void wforms_test()
       printf("\n%d\n\n", len);
     }
   }
+
+  fprintf(stderr, "\nWord formation cache: %lu hits, %lu misses.\n",
+          cache_hits, cache_misses);
 }
@@ -40,6 +40,16 @@
    list (currently either 'de' or 'en'). */
 list_t *wforms_add(list_t *lst, const char *lang);
 
+/* The results of wforms_add are cached. The cache is keyed by the words,
+   the language and the options, so it never returns stale results; this
+   function may be used to release the memory it occupies. */
+void wforms_cache_clear();
+/* Returns the number of cache hits and misses since the program start. */
+void wforms_cache_stats(unsigned long *hits, unsigned long *misses);
+/* Returns a hash of the contents of the rules files read by wforms_init;
+   tables of word forms computed with other rules are stale. */
+unsigned wforms_rules_hash();
+
 /* Initializes the wforms module by loading and parsing conversion rules
    data files. */
 void wforms_init();